@@ -1,426 +1,993 @@
 // cpe351.cpp
+#include "cpe351.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <cstring>
 #include <climits>
-#include <unistd.h>
 #include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <getopt.h>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-struct Process {
-    int id;  // Process ID for tracking original order
-    int burst_time;
-    int arrival_time;
-    int priority;
-    int waiting_time;
-    int remaining_time;
-    int completion_time;
-    Process* next;
-    
-    Process(int pid, int bt, int at, int pr) : 
-        id(pid), burst_time(bt), arrival_time(at), priority(pr),
-        waiting_time(0), remaining_time(bt), completion_time(0),
-        next(nullptr) {}
+void print_usage() {
+    std::cerr << "Usage: ./cpe351 -t quantum -f input.txt -o output.txt\n"
+              << "       ./cpe351 convert -f input.txt -o trace.bin\n"
+              << "       ./cpe351 bench [options]  (see ./cpe351 bench -h)\n"
+              << "       ./cpe351 check [-s seed] [CHECK...]\n"
+              << "              Self-check code that ordinary runs rarely reach against\n"
+              << "              a simpler reference; CHECK is select, what-if,\n"
+              << "              sort or multicore (default all)\n"
+              << "       ./cpe351 batch -f INPUTS -o OUTDIR [options]\n"
+              << "              Schedule many traces: INPUTS is a directory, a quoted\n"
+              << "              glob pattern or @manifest (one path per line). Writes\n"
+              << "              OUTDIR/<name>.out per input and OUTDIR/summary.txt with\n"
+              << "              input:processes:average waiting per algorithm\n"
+              << "Options:\n"
+              << "  -t  Time quantum for Round Robin, lottery and stride scheduling\n"
+              << "  -f  Input file name (text or binary trace). Text lines are\n"
+              << "              burst:arrival:priority with an optional :deadline, the\n"
+              << "              deadline counted from arrival. The burst may be a list of\n"
+              << "              alternating CPU and I/O bursts, cpu,io,...,cpu (not with\n"
+              << "              --stream, --what-if, --cpus, --rr-sweep or convert)\n"
+              << "  -o  Output file name\n"
+              << "  -j, --jobs N  Run the algorithms on up to N threads (with batch,\n"
+              << "              schedule up to N traces at once)\n"
+              << "  --max-loaded N  With batch, keep at most N traces in memory\n"
+              << "  -q, --quiet  Do not echo results to the console\n"
+              << "  --rr-sweep  Run Round Robin as the original id-order sweep\n"
+              << "  --mlfq-levels N     Multilevel feedback queue levels, 1-64 (default 3)\n"
+              << "  --mlfq-boost T      Move every process back to the top level every\n"
+              << "              T time units, 0 to never boost (default 100)\n"
+              << "  --mlfq-no-demote    Keep processes at their level when their\n"
+              << "              quantum expires\n"
+              << "  --cfs-latency L     Period in which the fair scheduler runs every\n"
+              << "              runnable process (default 24)\n"
+              << "  --lottery-seed N    Seed of the lottery scheduler's ticket draws\n"
+              << "              (default 1). Lottery and stride use each process's\n"
+              << "              priority as its tickets (at least 1)\n"
+              << "  --devices N         I/O devices serving the I/O bursts (default 1)\n"
+              << "  --device-order D    Order the devices serve waiting I/O in: fcfs\n"
+              << "              (default) or sjf, shortest I/O burst first\n"
+              << "  --adaptive-queue    Search ready sets of a few dozen processes with a\n"
+              << "              vector scan instead of the heap (SJF and Priority)\n"
+              << "  --metrics   Follow each result line with a `#` summary line:\n"
+              << "              throughput, utilization, context switches, and average\n"
+              << "              and p50/p90/p99/p99.9 waiting and turnaround time, and\n"
+              << "              when the trace has deadlines, misses and lateness. Lottery\n"
+              << "              and stride add share_error, the fraction of CPU time not\n"
+              << "              given in proportion to tickets, and share_lag_max. With\n"
+              << "              I/O bursts waiting leaves out time blocked on I/O, and\n"
+              << "              the line adds device_utilization per device and\n"
+              << "              io_overlap, the fraction of the makespan in which the CPU\n"
+              << "              and a device were busy at once\n"
+              << "  --summary   Write only the summary lines\n"
+              << "  --timeline FILE     Record every run slice of every algorithm to FILE\n"
+              << "              (runs the algorithms on one thread; not with convert,\n"
+              << "              --sweep-quantum or --what-if)\n"
+              << "  --timeline-format F  chrome (trace_event JSON, default) or binary\n"
+              << "  --stats     Print load, simulation and output timings and event\n"
+              << "              counts per algorithm as JSON on standard error\n"
+              << "  --stream ALG  Schedule processes with one algorithm (fcfs, sjf,\n"
+              << "              sjf-preemptive, priority, priority-preemptive, rr, edf or\n"
+              << "              edf-preemptive) as they are read, in arrival order, from\n"
+              << "              the input (- for standard input), writing\n"
+              << "              process:completion:waiting as each one completes\n"
+              << "  --sort-memory SIZE  With --stream, accept input in any order and\n"
+              << "              sort it by arrival first in SIZE bytes of memory (K, M or\n"
+              << "              G suffix), spilling sorted runs to $TMPDIR when the input\n"
+              << "              does not fit\n"
+              << "  --what-if ALG  Run one algorithm (fcfs, sjf, sjf-preemptive, priority,\n"
+              << "              priority-preemptive, rr, edf or edf-preemptive), then answer\n"
+              << "              queries read from standard input, one per line: a process\n"
+              << "              number and any of burst, arrival, priority and deadline as\n"
+              << "              field=value, field+=change or field-=change\n"
+              << "              (e.g. `42 arrival+=10 priority=5`).\n"
+              << "              Each query only re-simulates from the last checkpoint\n"
+              << "              before the change\n"
+              << "  --checkpoint-every K  Passes of the scheduling loop between\n"
+              << "              what-if checkpoints (default 1024)\n"
+              << "  --cpus N    Simulate N CPUs with per-core run queues and work\n"
+              << "              stealing (FCFS, SJF, Priority and Round Robin only)\n"
+              << "  --migration-cost C  Time lost when a process runs away from its\n"
+              << "              home core or last core (with --cpus, default 0)\n"
+              << "  --sweep-quantum START:END[:STEP]  Only run Round Robin, once per\n"
+              << "              quantum, writing quantum:avg waiting:avg turnaround:\n"
+              << "              context switches per line (at most 10000 quanta)\n";
+}
+
+// Long-only options
+enum {
+    OPT_RR_SWEEP = 256,
+    OPT_SWEEP_QUANTUM,
+    OPT_CPUS,
+    OPT_MIGRATION_COST,
+    OPT_MLFQ_LEVELS,
+    OPT_MLFQ_BOOST,
+    OPT_MLFQ_NO_DEMOTE,
+    OPT_CFS_LATENCY,
+    OPT_METRICS,
+    OPT_SUMMARY,
+    OPT_TIMELINE,
+    OPT_TIMELINE_FORMAT,
+    OPT_STREAM,
+    OPT_STATS,
+    OPT_MAX_LOADED,
+    OPT_ADAPTIVE_QUEUE,
+    OPT_WHAT_IF,
+    OPT_CHECKPOINT_EVERY,
+    OPT_SORT_MEMORY,
+    OPT_LOTTERY_SEED,
+    OPT_DEVICES,
+    OPT_DEVICE_ORDER
 };
 
-class ProcessList {
-private:
-    Process* head;
-    int size;
+void print_bench_usage() {
+    std::cerr << "Usage: ./cpe351 bench [options]\n"
+              << "Times every algorithm on generated traces and prints one JSON\n"
+              << "object per line. Each trace size runs in its own process, and\n"
+              << "peak_rss_kb is that process's peak resident set size.\n"
+              << "Options:\n"
+              << "  -w, --workload NAME     poisson, pareto, storm or all (default all)\n"
+              << "  -n, --sizes LIST        Comma-separated process counts\n"
+              << "                          (default 1000,10000,100000,1000000,10000000)\n"
+              << "  -p, --priorities DIST   uniform, skewed or constant (default uniform)\n"
+              << "  -l, --levels N          Number of priority levels (default 10)\n"
+              << "  -b, --mean-burst X      Mean burst time (default 10)\n"
+              << "  -L, --load X            Offered CPU load (default 0.9)\n"
+              << "  -s, --seed N            Generator seed (default 1)\n"
+              << "  -d, --deadline-slack X  Give each process a deadline X times its burst\n"
+              << "                          after its arrival (default 0, no deadlines)\n"
+              << "  -t, --quantum N         Time quantum for Round Robin (default 2)\n"
+              << "  -o, --output FILE       Write results to FILE instead of stdout\n"
+              << "  --adaptive-queue        Time SJF and Priority with the scanning ready\n"
+              << "                          queue instead of the heap\n";
+}
 
-public:
-    ProcessList() : head(nullptr), size(0) {}
-    
-    void insert(int id, int burst_time, int arrival_time, int priority) {
-        Process* newProcess = new Process(id, burst_time, arrival_time, priority);
-        if (!head) {
-            head = newProcess;
-        } else {
-            Process* current = head;
-            while (current->next) {
-                current = current->next;
+// Timing of one algorithm on one generated trace
+struct BenchRow {
+    int algorithm_id;
+    int repeats;
+    double wall_per_run;
+    long long simulated_time;
+};
+
+// Generate a trace of `size` processes and time every algorithm on it in
+// a forked child, so `peak_rss_kb` is the peak resident set of that one
+// measurement rather than a high-water mark left by a larger size before
+// it. Throws if the child fails.
+std::vector<BenchRow> bench_size(const WorkloadSpec& spec, long long size, int quantum,
+                                 bool adaptive_queue, long& peak_rss_kb) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) throw std::runtime_error("Cannot create a pipe for bench");
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t child = fork();
+    if (child < 0) throw std::runtime_error("Cannot fork a bench process");
+
+    if (child == 0) {
+        close(pipe_fds[0]);
+        try {
+            Scheduler scheduler(quantum);
+            scheduler.configureReadyQueue(adaptive_queue);
+            scheduler.generateProcesses(spec, static_cast<int>(size));
+
+            // Small traces are repeated so each measurement covers at
+            // least ~10^5 scheduled processes
+            int repeats = static_cast<int>(std::max(1LL, 100000 / size));
+            for (int id = 1; id <= Scheduler::algorithmCount(); id++) {
+                long long wall_ns = 0;
+                long long simulated_time = 0;
+                for (int i = 0; i < repeats; i++) {
+                    wall_ns += scheduler.timeAlgorithm(id, simulated_time);
+                }
+                BenchRow row = {id, repeats, static_cast<double>(wall_ns) / repeats,
+                                simulated_time};
+                if (write(pipe_fds[1], &row, sizeof(row)) != static_cast<ssize_t>(sizeof(row))) {
+                    _exit(1);
+                }
             }
-            current->next = newProcess;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            _exit(1);
         }
-        size++;
+        _exit(0);
     }
-    
-    Process* getHead() { return head; }
-    int getSize() { return size; }
-    
-    void resetProcesses() {
-        Process* current = head;
-        while (current) {
-            current->waiting_time = 0;
-            current->remaining_time = current->burst_time;
-            current->completion_time = 0;
-            current = current->next;
-        }
+
+    close(pipe_fds[1]);
+    std::vector<BenchRow> rows;
+    BenchRow row;
+    while (read(pipe_fds[0], &row, sizeof(row)) == static_cast<ssize_t>(sizeof(row))) {
+        rows.push_back(row);
+    }
+    close(pipe_fds[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) != child || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("Bench of " + spec.name + " with " + std::to_string(size) +
+                                 " processes failed");
     }
+    peak_rss_kb = usage.ru_maxrss;
+    return rows;
+}
+
+int bench_main(int argc, char* argv[]) {
+    std::string workload = "all";
+    std::string output_file;
+    std::vector<long long> sizes = {1000, 10000, 100000, 1000000, 10000000};
+    WorkloadSpec base = {"", WorkloadSpec::POISSON, WorkloadSpec::EXPONENTIAL,
+                         WorkloadSpec::UNIFORM, 10, 10.0, 0.9, 1, 0.0};
+    int quantum = 2;
+    bool adaptive_queue = false;
+    int opt;
+
+    static struct option long_options[] = {
+        {"workload", required_argument, 0, 'w'},
+        {"sizes", required_argument, 0, 'n'},
+        {"priorities", required_argument, 0, 'p'},
+        {"levels", required_argument, 0, 'l'},
+        {"mean-burst", required_argument, 0, 'b'},
+        {"load", required_argument, 0, 'L'},
+        {"seed", required_argument, 0, 's'},
+        {"deadline-slack", required_argument, 0, 'd'},
+        {"quantum", required_argument, 0, 't'},
+        {"output", required_argument, 0, 'o'},
+        {"adaptive-queue", no_argument, 0, OPT_ADAPTIVE_QUEUE},
+        {0, 0, 0, 0}
+    };
 
-    ProcessList* clone() {
-        ProcessList* newList = new ProcessList();
-        Process* current = head;
-        while (current) {
-            newList->insert(current->id, current->burst_time, 
-                          current->arrival_time, current->priority);
-            current = current->next;
+    while ((opt = getopt_long(argc, argv, "w:n:p:l:b:L:s:d:t:o:", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'w':
+                workload = optarg;
+                break;
+            case 'n': {
+                sizes.clear();
+                std::string list = optarg;
+                size_t start = 0;
+                while (start <= list.size()) {
+                    size_t comma = list.find(',', start);
+                    if (comma == std::string::npos) comma = list.size();
+                    long long size = std::atoll(list.substr(start, comma - start).c_str());
+                    if (size <= 0 || size > INT_MAX) {
+                        std::cerr << "Error: Sizes must be positive process counts\n";
+                        return 1;
+                    }
+                    sizes.push_back(size);
+                    start = comma + 1;
+                }
+                break;
+            }
+            case 'p':
+                if (std::strcmp(optarg, "uniform") == 0) {
+                    base.priorities = WorkloadSpec::UNIFORM;
+                } else if (std::strcmp(optarg, "skewed") == 0) {
+                    base.priorities = WorkloadSpec::SKEWED;
+                } else if (std::strcmp(optarg, "constant") == 0) {
+                    base.priorities = WorkloadSpec::CONSTANT;
+                } else {
+                    std::cerr << "Error: Unknown priority distribution " << optarg << "\n";
+                    return 1;
+                }
+                break;
+            case 'l':
+                base.priority_levels = std::atoi(optarg);
+                if (base.priority_levels <= 0) {
+                    std::cerr << "Error: Priority levels must be positive\n";
+                    return 1;
+                }
+                break;
+            case 'b':
+                base.mean_burst = std::atof(optarg);
+                if (base.mean_burst < 1) {
+                    std::cerr << "Error: Mean burst must be at least 1\n";
+                    return 1;
+                }
+                break;
+            case 'L':
+                base.load = std::atof(optarg);
+                if (base.load <= 0) {
+                    std::cerr << "Error: Load must be positive\n";
+                    return 1;
+                }
+                break;
+            case 's':
+                base.seed = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'd':
+                base.deadline_slack = std::atof(optarg);
+                if (base.deadline_slack < 0) {
+                    std::cerr << "Error: Deadline slack must not be negative\n";
+                    return 1;
+                }
+                break;
+            case 't':
+                quantum = std::atoi(optarg);
+                if (quantum <= 0) {
+                    std::cerr << "Error: Time quantum must be positive\n";
+                    return 1;
+                }
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case OPT_ADAPTIVE_QUEUE:
+                adaptive_queue = true;
+                break;
+            default:
+                print_bench_usage();
+                return 1;
         }
-        return newList;
     }
 
-    ~ProcessList() {
-        while (head) {
-            Process* temp = head;
-            head = head->next;
-            delete temp;
-        }
+    std::vector<WorkloadSpec> workloads;
+    WorkloadSpec spec = base;
+    if (workload == "poisson" || workload == "all") {
+        spec.name = "poisson";
+        spec.arrivals = WorkloadSpec::POISSON;
+        spec.bursts = WorkloadSpec::EXPONENTIAL;
+        workloads.push_back(spec);
+    }
+    if (workload == "pareto" || workload == "all") {
+        spec.name = "pareto";
+        spec.arrivals = WorkloadSpec::POISSON;
+        spec.bursts = WorkloadSpec::PARETO;
+        workloads.push_back(spec);
+    }
+    if (workload == "storm" || workload == "all") {
+        spec.name = "storm";
+        spec.arrivals = WorkloadSpec::STORM;
+        spec.bursts = WorkloadSpec::PARETO;
+        workloads.push_back(spec);
+    }
+    if (workloads.empty()) {
+        std::cerr << "Error: Unknown workload " << workload << "\n";
+        return 1;
     }
-};
 
-class Scheduler {
-private:
-    ProcessList* processes;
-    int quantum;
-    int process_count;
-
-    void calculateFCFS() {
-        Process* current = processes->getHead();
-        int current_time = 0;
-        
-        // Sort processes by arrival time (bubble sort)
-        for (int i = 0; i < process_count - 1; i++) {
-            Process* current = processes->getHead();
-            while (current->next) {
-                if (current->arrival_time > current->next->arrival_time) {
-                    // Swap process data
-                    std::swap(current->id, current->next->id);
-                    std::swap(current->burst_time, current->next->burst_time);
-                    std::swap(current->arrival_time, current->next->arrival_time);
-                    std::swap(current->priority, current->next->priority);
-                }
-                current = current->next;
-            }
-        }
-        
-        current = processes->getHead();
-        while (current) {
-            if (current_time < current->arrival_time) {
-                current_time = current->arrival_time;
-            }
-            
-            current->waiting_time = current_time - current->arrival_time;
-            current_time += current->burst_time;
-            current->completion_time = current_time;
-            current = current->next;
+    std::ofstream file;
+    if (!output_file.empty()) {
+        file.open(output_file);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open output file\n";
+            return 1;
         }
     }
+    std::ostream& out = output_file.empty() ? std::cout : file;
 
-    void calculateSJFNonPreemptive() {
-        int current_time = 0;
-        int completed = 0;
-        
-        while (completed != process_count) {
-            Process* shortest = nullptr;
-            int min_burst = INT_MAX;
-            
-            Process* current = processes->getHead();
-            while (current) {
-                if (current->arrival_time <= current_time && 
-                    current->remaining_time > 0 && 
-                    current->remaining_time < min_burst) {
-                    min_burst = current->remaining_time;
-                    shortest = current;
-                }
-                current = current->next;
-            }
-            
-            if (!shortest) {
-                current_time++;
-                continue;
+    try {
+        for (const WorkloadSpec& current : workloads) {
+            for (long long size : sizes) {
+                long peak_rss_kb = 0;
+                std::vector<BenchRow> rows = bench_size(current, size, quantum, adaptive_queue,
+                                                        peak_rss_kb);
+                for (const BenchRow& row : rows) {
+                    double wall_per_run = row.wall_per_run;
+                    long long simulated_time = row.simulated_time;
+                    char line[512];
+                    std::snprintf(line, sizeof(line),
+                                  "{\"workload\":\"%s\",\"priorities\":\"%s\",\"seed\":%llu,"
+                                  "\"processes\":%lld,\"algorithm\":\"%s\",\"quantum\":%d,"
+                                  "\"repeats\":%d,\"wall_ns\":%.0f,\"ns_per_process\":%.3f,"
+                                  "\"peak_rss_kb\":%ld,\"simulated_time\":%lld,"
+                                  "\"sim_wall_ratio\":%.6g}",
+                                  current.name.c_str(),
+                                  current.priorities == WorkloadSpec::UNIFORM ? "uniform" :
+                                  current.priorities == WorkloadSpec::SKEWED ? "skewed" : "constant",
+                                  static_cast<unsigned long long>(current.seed), size,
+                                  Scheduler::algorithmName(row.algorithm_id), quantum,
+                                  row.repeats, wall_per_run,
+                                  wall_per_run / static_cast<double>(size), peak_rss_kb,
+                                  simulated_time,
+                                  wall_per_run > 0 ? simulated_time / (wall_per_run * 1e-9) : 0.0);
+                    out << line << '\n' << std::flush;
+                }
             }
-            
-            shortest->waiting_time = current_time - shortest->arrival_time;
-            current_time += shortest->burst_time;
-            shortest->remaining_time = 0;
-            shortest->completion_time = current_time;
-            completed++;
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
     }
+    return 0;
+}
 
-    void calculateSJFPreemptive() {
-        int current_time = 0;
-        int completed = 0;
-        
-        while (completed != process_count) {
-            Process* shortest = nullptr;
-            int min_remaining = INT_MAX;
-            
-            Process* current = processes->getHead();
-            while (current) {
-                if (current->arrival_time <= current_time && 
-                    current->remaining_time > 0 && 
-                    current->remaining_time < min_remaining) {
-                    min_remaining = current->remaining_time;
-                    shortest = current;
-                }
-                current = current->next;
+// Compare every SelectKernel target with the scalar reference over random
+// keys drawn from a few values, so most calls have to break ties, at every
+// length around the 4-, 8- and 16-lane block edges. Returns the number of
+// mismatches.
+int check_select(std::mt19937_64& random) {
+    std::vector<SelectKernel::Target> kernels = SelectKernel::targets();
+    int failures = 0;
+    long long cases = 0;
+    std::vector<int> keys, ties;
+    for (int length = 0; length <= 72; length++) {
+        for (int round = 0; round < 400; round++) {
+            int spread = 1 + static_cast<int>(random() % 4);
+            keys.resize(length);
+            ties.resize(length);
+            for (int i = 0; i < length; i++) {
+                keys[i] = static_cast<int>(random() % spread) + (round % 3 == 0 ? INT_MIN : 0);
+                ties[i] = static_cast<int>(random() % spread) + (round % 5 == 0 ? INT_MAX - 3 : 0);
             }
-            
-            if (!shortest) {
-                current_time++;
-                continue;
-            }
-            
-            shortest->remaining_time--;
-            current_time++;
-            
-            if (shortest->remaining_time == 0) {
-                completed++;
-                shortest->completion_time = current_time;
-                shortest->waiting_time = shortest->completion_time - 
-                                      shortest->arrival_time - 
-                                      shortest->burst_time;
+            int expected = SelectKernel::scalar(keys.data(), ties.data(), length);
+            for (const SelectKernel::Target& kernel : kernels) {
+                int got = kernel.function(keys.data(), ties.data(), length);
+                if (got != expected && failures++ < 10) {
+                    std::cerr << "select: " << kernel.name << " picked " << got << " instead of "
+                              << expected << " of " << length << " keys\n";
+                }
             }
+            if (SelectKernel::argMin(keys.data(), ties.data(), length) != expected) failures++;
+            cases++;
         }
     }
+    std::cout << "select: " << cases << " cases on";
+    for (const SelectKernel::Target& kernel : kernels) std::cout << ' ' << kernel.name;
+    std::cout << (failures == 0 ? ", ok\n" : ", FAILED\n");
+    return failures;
+}
 
-    void calculatePriorityNonPreemptive() {
-        int current_time = 0;
-        int completed = 0;
-        
-        while (completed != process_count) {
-            Process* highest_priority = nullptr;
-            int max_priority = INT_MIN;
-            
-            Process* current = processes->getHead();
-            while (current) {
-                if (current->arrival_time <= current_time && 
-                    current->remaining_time > 0 && 
-                    current->priority > max_priority) {
-                    max_priority = current->priority;
-                    highest_priority = current;
-                }
-                current = current->next;
-            }
-            
-            if (!highest_priority) {
-                current_time++;
-                continue;
+// A temporary file in $TMPDIR (default /tmp) for a check, removed when it
+// goes out of scope
+struct CheckFile {
+    std::string path;
+
+    CheckFile() {
+        const char* directory = std::getenv("TMPDIR");
+        path = std::string(directory && *directory ? directory : "/tmp") + "/cpe351-check-XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0) throw std::runtime_error("Could not create a temporary file for the check");
+        close(fd);
+    }
+    CheckFile(const CheckFile&) = delete;
+    CheckFile& operator=(const CheckFile&) = delete;
+    ~CheckFile() { std::remove(path.c_str()); }
+};
+
+// Write `trace` as a text trace, one record per process in id order
+void write_check_trace(const std::string& path, const std::vector<WhatIf::Edit>& trace) {
+    std::ofstream out(path, std::ios::trunc);
+    for (const WhatIf::Edit& process : trace) {
+        out << process.burst_time << ':' << process.arrival_time << ':' << process.priority;
+        if (process.deadline != ProcessTable::NO_DEADLINE) out << ':' << process.deadline;
+        out << '\n';
+    }
+    if (!out) throw std::runtime_error("Could not write " + path);
+}
+
+// Load `trace_file` and run one algorithm on it the ordinary way; returns
+// the waiting time of each of its `count` processes by id
+std::vector<long long> run_loaded(const std::string& trace_file, const std::string& output_file,
+                                  int algorithm_id, int quantum, int count) {
+    Scheduler scheduler(quantum, false, 1, false);
+    scheduler.loadProcesses(trace_file);
+    scheduler.runOneAlgorithm(algorithm_id, output_file);
+    std::ifstream in(output_file);
+    std::string line;
+    std::getline(in, line);
+    char* end;
+    std::strtol(line.c_str(), &end, 10);
+    std::vector<long long> waiting(count);
+    for (int i = 0; i < count; i++) {
+        if (*end != ':') throw std::runtime_error("Unexpected result line " + line);
+        waiting[i] = std::strtoll(end + 1, &end, 10);
+    }
+    return waiting;
+}
+
+// Compare WhatIf answers with a full run of the edited trace, for every
+// algorithm it supports, over small random traces with checkpoints a few
+// passes apart. Edits move arrivals anywhere in the trace and also just
+// before, at and just after the checkpoint the last query resumed from.
+// Returns the number of mismatches.
+int check_what_if(std::mt19937_64& random) {
+    static const int algorithms[] = {1, 2, 3, 4, 5, 6, 9, 10};
+    CheckFile trace_file, output_file;
+    int failures = 0;
+    long long queries = 0;
+    long long mid_run = 0;  // queries resumed from a checkpoint after the start
+    auto draw = [&](int bound) { return static_cast<int>(random() % bound); };
+    for (int round = 0; round < 40; round++) {
+        int count = 1 + draw(48);
+        int last_arrival = 1 + draw(40);
+        int quantum = 1 + draw(3);
+        int interval = 1 + draw(3);
+        std::vector<WhatIf::Edit> trace(count);
+        for (int id = 0; id < count; id++) {
+            trace[id] = WhatIf::Edit{id, draw(10), draw(last_arrival), draw(5),
+                                     draw(3) == 0 ? ProcessTable::NO_DEADLINE : draw(30)};
+        }
+        write_check_trace(trace_file.path, trace);
+        ProcessTable table;
+        TraceParser::load(MappedFile(trace_file.path), table, 1);
+
+        for (int algorithm_id : algorithms) {
+            const char* name = Scheduler::algorithmName(algorithm_id);
+            std::vector<long long> before =
+                run_loaded(trace_file.path, output_file.path, algorithm_id, quantum, count);
+            WhatIf what_if(table, algorithm_id, quantum, interval);
+            long long resumed_at = 0;
+            for (int query = 0; query < 24; query++) {
+                int id = draw(count);
+                WhatIf::Edit edit = what_if.original(id);
+                if (query % 2 == 1) {
+                    edit.arrival_time = std::max(0, static_cast<int>(resumed_at) + draw(3) - 1);
+                } else if (draw(2) == 0) {
+                    edit.arrival_time = draw(last_arrival + 8);
+                }
+                if (draw(3) == 0) edit.burst_time = draw(10);
+                if (draw(4) == 0) edit.priority = draw(5);
+                if (draw(4) == 0) edit.deadline = draw(3) == 0 ? ProcessTable::NO_DEADLINE : draw(30);
+
+                WhatIf::Answer answer = what_if.query(edit);
+                std::vector<WhatIf::Edit> edited = trace;
+                edited[id] = edit;
+                write_check_trace(trace_file.path, edited);
+                std::vector<long long> after =
+                    run_loaded(trace_file.path, output_file.path, algorithm_id, quantum, count);
+                long double total_waiting = 0;
+                int changed = 0;
+                for (int other = 0; other < count; other++) {
+                    total_waiting += after[other];
+                    if (other != id && after[other] != before[other]) changed++;
+                }
+                long long completion_time = edit.arrival_time + edit.burst_time + after[id];
+                if ((answer.total_waiting != total_waiting || answer.waiting_time != after[id] ||
+                     answer.completion_time != completion_time || answer.changed != changed) &&
+                    failures++ < 10) {
+                    std::cerr << "what-if: " << name << " process " << id + 1 << " burst="
+                              << edit.burst_time << " arrival=" << edit.arrival_time
+                              << " resumed at " << answer.resumed_at << ": completion "
+                              << answer.completion_time << " instead of " << completion_time
+                              << ", total waiting " << static_cast<double>(answer.total_waiting)
+                              << " instead of " << static_cast<double>(total_waiting) << ", "
+                              << answer.changed << " others changed instead of " << changed
+                              << "\n";
+                }
+                if (answer.resumed_at > 0) mid_run++;
+                resumed_at = answer.resumed_at;
+                queries++;
             }
-            
-            highest_priority->waiting_time = current_time - highest_priority->arrival_time;
-            current_time += highest_priority->burst_time;
-            highest_priority->remaining_time = 0;
-            highest_priority->completion_time = current_time;
-            completed++;
+            write_check_trace(trace_file.path, trace);
         }
     }
+    std::cout << "what-if: " << queries << " queries, " << mid_run
+              << " resumed after the start" << (failures == 0 ? ", ok\n" : ", FAILED\n");
+    return failures;
+}
 
-    void calculatePriorityPreemptive() {
-        int current_time = 0;
-        int completed = 0;
-        
-        while (completed != process_count) {
-            Process* highest_priority = nullptr;
-            int max_priority = INT_MIN;
-            
-            Process* current = processes->getHead();
-            while (current) {
-                if (current->arrival_time <= current_time && 
-                    current->remaining_time > 0 && 
-                    current->priority > max_priority) {
-                    max_priority = current->priority;
-                    highest_priority = current;
-                }
-                current = current->next;
+// Stream unsorted traces through a 1K --sort-memory budget (raised to
+// ArrivalSort's least, which still spills the larger traces into runs that
+// take several merge passes) and compare every streaming algorithm with the
+// loaded run of the same trace. Also checks the sorted order itself.
+// Returns the number of mismatches.
+int check_sort(std::mt19937_64& random) {
+    static const int algorithms[] = {1, 2, 3, 4, 5, 6, 9, 10};
+    static const int sizes[] = {1000, 20000, 70000};
+    const size_t memory_budget = 1024;
+    CheckFile trace_file, output_file;
+    int failures = 0;
+    int runs = 0;
+    int most_spilled = 0;
+    int most_passes = 0;
+    auto draw = [&](int bound) { return static_cast<int>(random() % bound); };
+    auto fail = [&](const std::string& message) {
+        if (failures++ < 10) std::cerr << "sort: " << message << "\n";
+    };
+    for (int count : sizes) {
+        std::vector<WhatIf::Edit> trace(count);
+        for (int id = 0; id < count; id++) {
+            trace[id] = WhatIf::Edit{id, draw(10), draw(count / 2), draw(5),
+                                     draw(3) == 0 ? ProcessTable::NO_DEADLINE : draw(60)};
+        }
+        write_check_trace(trace_file.path, trace);
+
+        TraceStream input(trace_file.path);
+        input.acceptAnyOrder();
+        ArrivalSort sorted(input, memory_budget);
+        most_spilled = std::max(most_spilled, sorted.spilledRuns());
+        most_passes = std::max(most_passes, sorted.mergePasses());
+        WhatIf::Edit record, previous{-1, 0, -1, 0, 0};
+        std::vector<bool> seen(count);
+        int read = 0;
+        while (sorted.next(record.id, record.burst_time, record.arrival_time, record.priority,
+                           record.deadline)) {
+            const WhatIf::Edit& expected = trace[record.id];
+            if (record.arrival_time < previous.arrival_time ||
+                (record.arrival_time == previous.arrival_time && record.id < previous.id) ||
+                seen[record.id] || record.burst_time != expected.burst_time ||
+                record.arrival_time != expected.arrival_time ||
+                record.priority != expected.priority || record.deadline != expected.deadline) {
+                fail("process " + std::to_string(record.id + 1) + " out of order or changed in " +
+                     std::to_string(count) + " sorted records");
             }
-            
-            if (!highest_priority) {
-                current_time++;
-                continue;
+            seen[record.id] = true;
+            previous = record;
+            read++;
+        }
+        if (read != count) {
+            fail(std::to_string(read) + " of " + std::to_string(count) + " records sorted");
+        }
+
+        for (int algorithm_id : algorithms) {
+            const char* name = Scheduler::algorithmName(algorithm_id);
+            std::vector<long long> waiting =
+                run_loaded(trace_file.path, output_file.path, algorithm_id, 2, count);
+            Scheduler scheduler(2, false, 1, false);
+            scheduler.configureStreamSort(memory_budget);
+            scheduler.runStream(trace_file.path, algorithm_id, output_file.path);
+            std::ifstream in(output_file.path);
+            std::vector<bool> done(count);
+            std::string line;
+            int lines = 0;
+            while (std::getline(in, line)) {
+                char* end;
+                long process = std::strtol(line.c_str(), &end, 10);
+                long long completion_time = std::strtoll(end + 1, &end, 10);
+                long long waiting_time = std::strtoll(end + 1, &end, 10);
+                int id = static_cast<int>(process - 1);
+                if (id < 0 || id >= count || done[id] || waiting_time != waiting[id] ||
+                    completion_time != trace[id].arrival_time + trace[id].burst_time +
+                                       waiting_time) {
+                    fail(std::string(name) + " streamed " + line + " of " +
+                         std::to_string(count) + " processes");
+                    continue;
+                }
+                done[id] = true;
+                lines++;
             }
-            
-            highest_priority->remaining_time--;
-            current_time++;
-            
-            if (highest_priority->remaining_time == 0) {
-                completed++;
-                highest_priority->completion_time = current_time;
-                highest_priority->waiting_time = highest_priority->completion_time - 
-                                              highest_priority->arrival_time - 
-                                              highest_priority->burst_time;
+            if (lines != count) {
+                fail(std::string(name) + " streamed " + std::to_string(lines) + " of " +
+                     std::to_string(count) + " processes");
             }
+            runs++;
         }
     }
+    std::cout << "sort: " << runs << " streamed runs, up to " << most_spilled
+              << " spilled runs and " << most_passes << " merge passes"
+              << (failures == 0 ? ", ok\n" : ", FAILED\n");
+    return failures;
+}
 
-    void calculateRoundRobin() {
-        int current_time = 0;
-        int completed = 0;
-        
-        while (completed != process_count) {
-            bool processed = false;
-            Process* current = processes->getHead();
-            
-            while (current) {
-                if (current->arrival_time <= current_time && current->remaining_time > 0) {
-                    processed = true;
-                    
-                    if (current->remaining_time > quantum) {
-                        current_time += quantum;
-                        current->remaining_time -= quantum;
-                    } else {
-                        current_time += current->remaining_time;
-                        current->completion_time = current_time;
-                        current->waiting_time = current->completion_time - 
-                                             current->arrival_time - 
-                                             current->burst_time;
-                        current->remaining_time = 0;
-                        completed++;
-                    }
+// Two processes homed on different cores of two, one arriving long after
+// the other: each must run at once on its own core, with no steal or
+// migration, whichever core goes idle first. Returns the number of
+// mismatches.
+int check_multicore(std::mt19937_64&) {
+    static const char* const traces[] = {"5:100:1\n5:0:1\n", "5:0:1\n5:100:1\n"};
+    CheckFile trace_file, output_file;
+    int failures = 0;
+    int runs = 0;
+    for (const char* trace : traces) {
+        std::ofstream(trace_file.path, std::ios::trunc) << trace;
+        Scheduler scheduler(2, false, 1, false);
+        scheduler.configureReport(true, false);
+        scheduler.loadProcesses(trace_file.path);
+        scheduler.runMulticore(2, 5, output_file.path);
+        std::ifstream in(output_file.path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.find(" cpus=") == std::string::npos) continue;
+            int algorithm_id = std::atoi(line.c_str() + 2);
+            if (scheduler.totalWaiting(algorithm_id) != 0 ||
+                line.find(" steals=0 migrations=0") == std::string::npos) {
+                if (failures++ < 10) {
+                    std::cerr << "multicore: " << Scheduler::algorithmName(algorithm_id)
+                              << " waited " << static_cast<double>(
+                                     scheduler.totalWaiting(algorithm_id))
+                              << " on " << line << "\n";
                 }
-                current = current->next;
             }
-            
-            if (!processed) current_time++;
+            runs++;
         }
     }
+    if (runs != 8) failures++;
+    std::cout << "multicore: " << runs << " runs" << (failures == 0 ? ", ok\n" : ", FAILED\n");
+    return failures;
+}
 
-public:
-    Scheduler(int q = 2) : processes(nullptr), quantum(q), process_count(0) {}
+int check_main(int argc, char* argv[]) {
+    struct Check {
+        const char* name;
+        int (*run)(std::mt19937_64&);
+    };
+    static const Check checks[] = {
+        {"select", check_select},
+        {"what-if", check_what_if},
+        {"sort", check_sort},
+        {"multicore", check_multicore}
+    };
 
-    void loadProcesses(const std::string& input.txt) {
-        std::ifstream file(input.txt);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open input file");
+    uint64_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        if (opt != 's') {
+            print_usage();
+            return 1;
         }
-
-        processes = new ProcessList();
-        std::string line;
-        int id = 0;
-        
-        while (std::getline(file, line)) {
-            int burst_time, arrival_time, priority;
-            if (sscanf(line.c_str(), "%d:%d:%d", &burst_time, &arrival_time, &priority) == 3) {
-                processes->insert(id++, burst_time, arrival_time, priority);
-                process_count++;
-            }
+        seed = std::strtoull(optarg, nullptr, 10);
+    }
+    std::vector<const Check*> selected;
+    for (int i = optind; i < argc; i++) {
+        const Check* match = nullptr;
+        for (const Check& check : checks) {
+            if (std::strcmp(argv[i], check.name) == 0) match = &check;
+        }
+        if (!match) {
+            std::cerr << "Error: Unknown check " << argv[i] << "\n";
+            return 1;
         }
-        file.close();
+        selected.push_back(match);
+    }
+    if (selected.empty()) {
+        for (const Check& check : checks) selected.push_back(&check);
     }
 
-    void runAllAlgorithms(const std::string& output.txt) {
-        std::ofstream outFile(output.txt);
-        if (!outFile.is_open()) {
-            throw std::runtime_error("Could not open output file");
+    int failures = 0;
+    try {
+        for (const Check* check : selected) {
+            std::mt19937_64 random(seed);
+            failures += check->run(random);
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return failures > 0 ? 1 : 0;
+}
 
-        // Run each algorithm
-        ProcessList* original = processes->clone();
-        
-        // FCFS
-        calculateFCFS();
-        writeResults(1, outFile);
-        processes = original->clone();
-        processes->resetProcesses();
-
-        // SJF Non-preemptive
-        calculateSJFNonPreemptive();
-        writeResults(2, outFile);
-        processes = original->clone();
-        processes->resetProcesses();
-
-        // SJF Preemptive
-        calculateSJFPreemptive();
-        writeResults(3, outFile);
-        processes = original->clone();
-        processes->resetProcesses();
-
-        // Priority Non-preemptive
-        calculatePriorityNonPreemptive();
-        writeResults(4, outFile);
-        processes = original->clone();
-        processes->resetProcesses();
-
-        // Priority Preemptive
-        calculatePriorityPreemptive();
-        writeResults(5, outFile);
-        processes = original->clone();
-        processes->resetProcesses();
-
-        // Round Robin
-        calculateRoundRobin();
-        writeResults(6, outFile);
-
-        outFile.close();
-        delete original;
-    }
-
-private:
-    void writeResults(int algorithm_id, std::ofstream& outFile) {
-        // Prepare output string
-        std::string output = std::to_string(algorithm_id);
-        float total_waiting_time = 0;
-
-        // Create a temporary array for sorting by original process ID
-        struct TempResult {
-            int id;
-            int waiting_time;
-        };
-        TempResult* results = new TempResult[process_count];
-        int idx = 0;
-
-        // Store results
-        Process* current = processes->getHead();
-        while (current) {
-            results[idx].id = current->id;
-            results[idx].waiting_time = current->waiting_time;
-            total_waiting_time += current->waiting_time;
-            current = current->next;
-            idx++;
-        }
+// Parses a byte count with an optional K, M or G suffix (powers of 1024);
+// 0 if `text` is not one
+size_t parse_size(const char* text) {
+    char* end;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text || *text == '-' || errno == ERANGE) return 0;
+    int shift = 0;
+    switch (*end) {
+        case 'k': case 'K': shift = 10; end++; break;
+        case 'm': case 'M': shift = 20; end++; break;
+        case 'g': case 'G': shift = 30; end++; break;
+    }
+    if (*end != '\0' || value > (SIZE_MAX >> shift)) return 0;
+    return static_cast<size_t>(value) << shift;
+}
 
-        // Sort by original process ID
-        for (int i = 0; i < process_count - 1; i++) {
-            for (int j = 0; j < process_count - i - 1; j++) {
-                if (results[j].id > results[j + 1].id) {
-                    std::swap(results[j], results[j + 1]);
-                }
-            }
+// Expands a batch input spec into trace paths: every regular file in a
+// directory (sorted by name), the lines of an @manifest, or a glob pattern
+std::vector<std::string> batch_inputs(const std::string& spec) {
+    std::vector<std::string> paths;
+    struct stat info;
+    if (!spec.empty() && spec[0] == '@') {
+        std::ifstream manifest(spec.substr(1));
+        if (!manifest) throw std::runtime_error("Cannot open manifest " + spec.substr(1));
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty() && line[0] != '#') paths.push_back(line);
         }
-
-        // Build output string
-        for (int i = 0; i < process_count; i++) {
-            output += ":" + std::to_string(results[i].waiting_time);
+    } else if (stat(spec.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        DIR* dir = opendir(spec.c_str());
+        if (!dir) throw std::runtime_error("Cannot open directory " + spec);
+        while (struct dirent* entry = readdir(dir)) {
+            std::string path = spec + "/" + entry->d_name;
+            if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) paths.push_back(path);
+        }
+        closedir(dir);
+        std::sort(paths.begin(), paths.end());
+    } else {
+        glob_t matches;
+        if (glob(spec.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) paths.push_back(matches.gl_pathv[i]);
         }
+        globfree(&matches);
+    }
+    if (paths.empty()) throw std::runtime_error("No input traces match " + spec);
+    return paths;
+}
 
-        float avg_waiting_time = total_waiting_time / process_count;
-        output += ":" + std::to_string(avg_waiting_time);
+// Settings shared by every trace of a batch
+struct BatchOptions {
+    int quantum;
+    bool rr_sweep;
+    int mlfq_levels;
+    long long mlfq_boost;
+    bool mlfq_demote;
+    long long cfs_latency;
+    uint64_t lottery_seed;
+    int devices;
+    DevicePool::Discipline device_order;
+    bool adaptive_queue;
+    bool metrics, summary_only;
+};
 
-        // Write to both file and screen
-        outFile << output << std::endl;
-        std::cout << output << std::endl;
+// Runs every algorithm on every input, up to `workers` traces at a time on
+// a work-stealing pool, and writes one output per input plus summary.txt.
+// A trace that fails is reported in the summary and does not stop the rest.
+// Returns the number of failed traces.
+int run_batch(const std::vector<std::string>& inputs, const std::string& output_dir,
+              int workers, const BatchOptions& options) {
+    if (mkdir(output_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Cannot create directory " + output_dir + ": " +
+                                 std::strerror(errno));
+    }
 
-        delete[] results;
+    // <name>.out, or <name>.<n>.out when inputs from different directories share a name
+    std::vector<std::string> outputs(inputs.size());
+    std::vector<std::string> taken;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        size_t slash = inputs[i].find_last_of('/');
+        std::string name = slash == std::string::npos ? inputs[i] : inputs[i].substr(slash + 1);
+        std::string output = name + ".out";
+        for (int n = 2; std::find(taken.begin(), taken.end(), output) != taken.end(); n++) {
+            output = name + "." + std::to_string(n) + ".out";
+        }
+        taken.push_back(output);
+        outputs[i] = output_dir + "/" + output;
     }
-};
 
-void print_usage() {
-    std::cerr << "Usage: ./cpe351 -t quantum -f input.txt -o output.txt\n"
-              << "Options:\n"
-              << "  -t  Time quantum for Round Robin scheduling\n"
-              << "  -f  Input file name\n"
-              << "  -o  Output file name\n";
+    struct Result {
+        int processes = 0;
+        std::vector<long double> waiting;
+        std::string error;
+    };
+    int algorithms = Scheduler::algorithmCount();
+    std::vector<Result> results(inputs.size());
+    parallelForStealing(static_cast<int>(inputs.size()), workers, [&](int task, int) {
+        Result& result = results[task];
+        try {
+            Scheduler scheduler(options.quantum, options.rr_sweep, 1, false);
+            scheduler.configureMLFQ(options.mlfq_levels, options.mlfq_boost, options.mlfq_demote);
+            scheduler.configureCFS(options.cfs_latency);
+            scheduler.configureLottery(options.lottery_seed);
+            scheduler.configureDevices(options.devices, options.device_order);
+            scheduler.configureReadyQueue(options.adaptive_queue);
+            scheduler.configureReport(options.metrics, options.summary_only);
+            scheduler.loadProcesses(inputs[task]);
+            scheduler.runAllAlgorithms(outputs[task]);
+            result.processes = scheduler.processCount();
+            for (int id = 1; id <= algorithms; id++) {
+                result.waiting.push_back(scheduler.totalWaiting(id));
+            }
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+    });
+
+    std::ofstream summary(output_dir + "/summary.txt");
+    if (!summary) throw std::runtime_error("Cannot open " + output_dir + "/summary.txt");
+    long long total_processes = 0;
+    std::vector<long double> total_waiting(algorithms, 0);
+    int failed = 0;
+    char field[64];
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const Result& result = results[i];
+        if (!result.error.empty()) {
+            // One line per input, however long the message
+            std::string message = result.error;
+            std::replace(message.begin(), message.end(), '\n', ' ');
+            summary << inputs[i] << ":error:" << message << '\n';
+            std::cerr << "Error: " << inputs[i] << ": " << result.error << std::endl;
+            failed++;
+            continue;
+        }
+        summary << inputs[i] << ':' << result.processes;
+        for (int id = 0; id < algorithms; id++) {
+            std::snprintf(field, sizeof(field), ":%f", result.processes > 0
+                          ? static_cast<double>(result.waiting[id] / result.processes) : 0.0);
+            summary << field;
+            total_waiting[id] += result.waiting[id];
+        }
+        summary << '\n';
+        total_processes += result.processes;
+    }
+    // Averages over every process of every trace that ran
+    summary << "total:" << total_processes;
+    for (int id = 0; id < algorithms; id++) {
+        std::snprintf(field, sizeof(field), ":%f",
+                      total_processes > 0 ? static_cast<double>(total_waiting[id] / total_processes) : 0.0);
+        summary << field;
+    }
+    summary << '\n';
+    if (!summary) throw std::runtime_error("Cannot write " + output_dir + "/summary.txt");
+    return failed;
 }
 
 int main(int argc, char* argv[]) {
     int quantum = 2;  // default value
-    std::string input.txt, output.txt;
+    std::string input_file, output_file;
+    bool convert = false;
+    bool rr_sweep = false;
+    int jobs = 1;
+    bool quiet = false;
+    int sweep_first = 0, sweep_last = 0, sweep_step = 1;
+    int cpus = 0;
+    long long migration_cost = 0;
+    int mlfq_levels = 3;
+    long long mlfq_boost = 100;
+    bool mlfq_demote = true;
+    long long cfs_latency = 24;
+    uint64_t lottery_seed = 1;
+    int devices = 1;
+    DevicePool::Discipline device_order = DevicePool::FCFS;
+    bool metrics = false, summary_only = false;
+    std::string timeline_file;
+    Timeline::Format timeline_format = Timeline::CHROME;
+    int stream_algorithm = 0;
+    bool stats = false;
+    bool adaptive_queue = false;
+    int what_if_algorithm = 0;
+    int checkpoint_interval = 1024;
+    size_t sort_memory = 0;
+    bool batch = false;
+    int max_loaded = 0;
     int opt;
     bool has_input = false, has_output = false;
 
+    static struct option long_options[] = {
+        {"quantum", required_argument, 0, 't'},
+        {"input", required_argument, 0, 'f'},
+        {"output", required_argument, 0, 'o'},
+        {"jobs", required_argument, 0, 'j'},
+        {"quiet", no_argument, 0, 'q'},
+        {"rr-sweep", no_argument, 0, OPT_RR_SWEEP},
+        {"sweep-quantum", required_argument, 0, OPT_SWEEP_QUANTUM},
+        {"cpus", required_argument, 0, OPT_CPUS},
+        {"migration-cost", required_argument, 0, OPT_MIGRATION_COST},
+        {"mlfq-levels", required_argument, 0, OPT_MLFQ_LEVELS},
+        {"mlfq-boost", required_argument, 0, OPT_MLFQ_BOOST},
+        {"mlfq-no-demote", no_argument, 0, OPT_MLFQ_NO_DEMOTE},
+        {"cfs-latency", required_argument, 0, OPT_CFS_LATENCY},
+        {"lottery-seed", required_argument, 0, OPT_LOTTERY_SEED},
+        {"devices", required_argument, 0, OPT_DEVICES},
+        {"device-order", required_argument, 0, OPT_DEVICE_ORDER},
+        {"metrics", no_argument, 0, OPT_METRICS},
+        {"summary", no_argument, 0, OPT_SUMMARY},
+        {"timeline", required_argument, 0, OPT_TIMELINE},
+        {"timeline-format", required_argument, 0, OPT_TIMELINE_FORMAT},
+        {"stream", required_argument, 0, OPT_STREAM},
+        {"stats", no_argument, 0, OPT_STATS},
+        {"max-loaded", required_argument, 0, OPT_MAX_LOADED},
+        {"adaptive-queue", no_argument, 0, OPT_ADAPTIVE_QUEUE},
+        {"what-if", required_argument, 0, OPT_WHAT_IF},
+        {"checkpoint-every", required_argument, 0, OPT_CHECKPOINT_EVERY},
+        {"sort-memory", required_argument, 0, OPT_SORT_MEMORY},
+        {0, 0, 0, 0}
+    };
+
+    if (argc > 1 && std::strcmp(argv[1], "bench") == 0) {
+        return bench_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "check") == 0) {
+        return check_main(argc - 1, argv + 1);
+    }
+
+    // `convert` rewrites a text trace as a binary one
+    if (argc > 1 && std::strcmp(argv[1], "convert") == 0) {
+        convert = true;
+        argv++;
+        argc--;
+    }
+
+    // `batch` schedules every trace named by -f into the directory -o
+    if (argc > 1 && std::strcmp(argv[1], "batch") == 0) {
+        batch = true;
+        argv++;
+        argc--;
+    }
+
     // Parse command line arguments using getopt
-    while ((opt = getopt(argc, argv, "t:f:o:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "t:f:o:j:q", long_options, nullptr)) != -1) {
         switch (opt) {
             case 't':
                 quantum = std::atoi(optarg);
@@ -437,6 +1004,153 @@ int main(int argc, char* argv[]) {
                 output_file = optarg;
                 has_output = true;
                 break;
+            case 'j':
+                jobs = std::atoi(optarg);
+                if (jobs <= 0) {
+                    std::cerr << "Error: Number of jobs must be positive\n";
+                    return 1;
+                }
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case OPT_RR_SWEEP:
+                rr_sweep = true;
+                break;
+            case OPT_SWEEP_QUANTUM: {
+                int fields = sscanf(optarg, "%d:%d:%d", &sweep_first, &sweep_last, &sweep_step);
+                if (fields == 2) sweep_step = 1;
+                if (fields < 2 || sweep_first <= 0 || sweep_last < sweep_first || sweep_step <= 0) {
+                    std::cerr << "Error: --sweep-quantum expects START:END[:STEP] with "
+                              << "0 < START <= END and STEP > 0\n";
+                    return 1;
+                }
+                if (Scheduler::sweepPoints(sweep_first, sweep_last, sweep_step) >
+                    Scheduler::maxSweepPoints()) {
+                    std::cerr << "Error: --sweep-quantum runs at most "
+                              << Scheduler::maxSweepPoints() << " quanta; use a larger STEP\n";
+                    return 1;
+                }
+                break;
+            }
+            case OPT_CPUS:
+                cpus = std::atoi(optarg);
+                if (cpus <= 0) {
+                    std::cerr << "Error: Number of CPUs must be positive\n";
+                    return 1;
+                }
+                break;
+            case OPT_MIGRATION_COST:
+                migration_cost = std::atoll(optarg);
+                if (migration_cost < 0) {
+                    std::cerr << "Error: Migration cost must not be negative\n";
+                    return 1;
+                }
+                break;
+            case OPT_MLFQ_LEVELS:
+                mlfq_levels = std::atoi(optarg);
+                if (mlfq_levels < 1 || mlfq_levels > 64) {
+                    std::cerr << "Error: MLFQ levels must be between 1 and 64\n";
+                    return 1;
+                }
+                break;
+            case OPT_MLFQ_BOOST:
+                mlfq_boost = std::atoll(optarg);
+                if (mlfq_boost < 0) {
+                    std::cerr << "Error: MLFQ boost period must not be negative\n";
+                    return 1;
+                }
+                break;
+            case OPT_MLFQ_NO_DEMOTE:
+                mlfq_demote = false;
+                break;
+            case OPT_CFS_LATENCY:
+                cfs_latency = std::atoll(optarg);
+                if (cfs_latency <= 0) {
+                    std::cerr << "Error: CFS latency must be positive\n";
+                    return 1;
+                }
+                break;
+            case OPT_LOTTERY_SEED:
+                lottery_seed = std::strtoull(optarg, nullptr, 10);
+                break;
+            case OPT_DEVICES:
+                devices = std::atoi(optarg);
+                if (devices <= 0) {
+                    std::cerr << "Error: Number of devices must be positive\n";
+                    return 1;
+                }
+                break;
+            case OPT_DEVICE_ORDER:
+                if (std::strcmp(optarg, "fcfs") == 0) {
+                    device_order = DevicePool::FCFS;
+                } else if (std::strcmp(optarg, "sjf") == 0) {
+                    device_order = DevicePool::SHORTEST_FIRST;
+                } else {
+                    std::cerr << "Error: Device order must be fcfs or sjf\n";
+                    return 1;
+                }
+                break;
+            case OPT_METRICS:
+                metrics = true;
+                break;
+            case OPT_SUMMARY:
+                summary_only = true;
+                break;
+            case OPT_TIMELINE:
+                timeline_file = optarg;
+                break;
+            case OPT_TIMELINE_FORMAT:
+                if (std::strcmp(optarg, "chrome") == 0) {
+                    timeline_format = Timeline::CHROME;
+                } else if (std::strcmp(optarg, "binary") == 0) {
+                    timeline_format = Timeline::BINARY;
+                } else {
+                    std::cerr << "Error: Timeline format must be chrome or binary\n";
+                    return 1;
+                }
+                break;
+            case OPT_STATS:
+                stats = true;
+                break;
+            case OPT_ADAPTIVE_QUEUE:
+                adaptive_queue = true;
+                break;
+            case OPT_WHAT_IF:
+                what_if_algorithm = Scheduler::algorithmId(optarg);
+                if (what_if_algorithm == 0) {
+                    std::cerr << "Error: Unknown algorithm " << optarg << "\n";
+                    return 1;
+                }
+                break;
+            case OPT_CHECKPOINT_EVERY:
+                checkpoint_interval = std::atoi(optarg);
+                if (checkpoint_interval <= 0) {
+                    std::cerr << "Error: Checkpoint interval must be positive\n";
+                    return 1;
+                }
+                break;
+            case OPT_SORT_MEMORY:
+                sort_memory = parse_size(optarg);
+                if (sort_memory == 0) {
+                    std::cerr << "Error: Sort memory must be a positive size such as 512M\n";
+                    return 1;
+                }
+                break;
+            case OPT_MAX_LOADED:
+                max_loaded = std::atoi(optarg);
+                if (max_loaded <= 0) {
+                    std::cerr << "Error: --max-loaded must be positive\n";
+                    return 1;
+                }
+                break;
+            case OPT_STREAM:
+                stream_algorithm = Scheduler::algorithmId(optarg);
+                if (stream_algorithm == 0) {
+                    std::cerr << "Error: Unknown algorithm " << optarg << "\n";
+                    return 1;
+                }
+                break;
             default:
                 print_usage();
                 return 1;
@@ -449,11 +1163,78 @@ int main(int argc, char* argv[]) {
         print_usage();
         return 1;
     }
-    
+
+    if (sort_memory > 0 && stream_algorithm == 0) {
+        std::cerr << "Error: --sort-memory only applies to --stream\n";
+        return 1;
+    }
+
+    if (stream_algorithm > 0 && !batch &&
+        (convert || cpus > 0 || sweep_first > 0 || rr_sweep || what_if_algorithm > 0)) {
+        std::cerr << "Error: --stream does not support convert, --cpus, --sweep-quantum, "
+                  << "--rr-sweep or --what-if\n";
+        return 1;
+    }
+
+    if (batch) {
+        if (cpus > 0 || sweep_first > 0 || stream_algorithm > 0 || what_if_algorithm > 0 ||
+            !timeline_file.empty() || stats) {
+            std::cerr << "Error: batch does not support --cpus, --sweep-quantum, --stream, "
+                      << "--what-if, --timeline or --stats\n";
+            return 1;
+        }
+        try {
+            BatchOptions options = {quantum, rr_sweep, mlfq_levels, mlfq_boost, mlfq_demote,
+                                    cfs_latency, lottery_seed, devices, device_order,
+                                    adaptive_queue, metrics, summary_only};
+            int workers = max_loaded > 0 ? std::min(jobs, max_loaded) : jobs;
+            return run_batch(batch_inputs(input_file), output_file, workers, options) > 0 ? 1 : 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (convert + (what_if_algorithm > 0) + (cpus > 0) + (sweep_first > 0) > 1) {
+        std::cerr << "Error: Only one of convert, --what-if, --cpus and --sweep-quantum "
+                  << "can be used at a time\n";
+        print_usage();
+        return 1;
+    }
+
+    if (!timeline_file.empty() && (convert || sweep_first > 0 || what_if_algorithm > 0)) {
+        std::cerr << "Error: --timeline does not support convert, --sweep-quantum or --what-if\n";
+        return 1;
+    }
+
     try {
-        Scheduler scheduler(quantum);
-        scheduler.loadProcesses(input.txt);
-        scheduler.runAllAlgorithms(output.txt);
+        Scheduler scheduler(quantum, rr_sweep, jobs, !quiet);
+        scheduler.configureMLFQ(mlfq_levels, mlfq_boost, mlfq_demote);
+        scheduler.configureCFS(cfs_latency);
+        scheduler.configureLottery(lottery_seed);
+        scheduler.configureDevices(devices, device_order);
+        scheduler.configureReadyQueue(adaptive_queue);
+        scheduler.configureReport(metrics, summary_only);
+        scheduler.configureStats(stats);
+        scheduler.configureStreamSort(sort_memory);
+        if (!timeline_file.empty()) scheduler.recordTimeline(timeline_file, timeline_format);
+        if (stream_algorithm > 0) {
+            scheduler.runStream(input_file, stream_algorithm, output_file);
+        } else {
+            scheduler.loadProcesses(input_file);
+            if (convert) {
+                scheduler.saveBinaryTrace(output_file);
+            } else if (what_if_algorithm > 0) {
+                scheduler.runWhatIf(what_if_algorithm, checkpoint_interval, std::cin, output_file);
+            } else if (cpus > 0) {
+                scheduler.runMulticore(cpus, migration_cost, output_file);
+            } else if (sweep_first > 0) {
+                scheduler.sweepQuantum(sweep_first, sweep_last, sweep_step, output_file);
+            } else {
+                scheduler.runAllAlgorithms(output_file);
+            }
+        }
+        if (stats) scheduler.writeStats(std::cerr);
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
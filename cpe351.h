@@ -0,0 +1,4536 @@
+// cpe351.h
+// Scheduling engine shared by the command-line front ends: trace loading
+// and output, the process table, the policy-templated Engine and the
+// Scheduler that runs the algorithms over a loaded trace.
+#ifndef CPE351_H
+#define CPE351_H
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <cstddef>
+#include <charconv>
+#include <new>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <set>
+#include <queue>
+#include <tuple>
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <cerrno>
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <type_traits>
+#include <chrono>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CPE351_X86 1
+#endif
+#ifdef __GNUC__
+#define CPE351_NOINLINE __attribute__((noinline))
+#else
+#define CPE351_NOINLINE
+#endif
+
+// Read-only mapping of a whole file
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+
+public:
+    explicit MappedFile(const std::string& path) : bytes(nullptr), length(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open input file");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not stat input file");
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map input file");
+            }
+            bytes = static_cast<const char*>(mapping);
+            madvise(mapping, length, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (bytes) munmap(const_cast<char*>(bytes), length);
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// The bursts of a trace whose lines list them, by process id: process id
+// has bursts[start[id]] up to bursts[start[id + 1]], alternating CPU and
+// I/O and starting and ending with CPU. A process given a single burst has
+// just that one CPU burst.
+struct BurstCycles {
+    std::vector<long long> start;
+    std::vector<int> bursts;
+};
+
+// Structure-of-arrays process table. Every column is carved out of one
+// 64-byte aligned arena, so a run touches contiguous memory and resetting
+// between algorithms is a copy and two memsets instead of a reallocation.
+// Rows are kept in arrival order (stable, so equal arrivals stay in input
+// order); `id` is each row's position in the input file. A deadline is
+// relative to the process's arrival, NO_DEADLINE if it has none.
+//
+// The input columns are read-only to the algorithms. They either live in
+// the arena, point into a mapped binary trace, or are shared with another
+// table; `backing` keeps a mapping alive for as long as a table uses it.
+//
+// A trace may give a process alternating CPU and I/O bursts (`cycles`); its
+// burst_time is then the total of its CPU bursts, and remaining_time is
+// what is left of the CPU burst it is on.
+class Timeline;
+
+class ProcessTable {
+public:
+    // Writable input columns of a table built by allocate()
+    struct InputColumns {
+        int* id;
+        int* burst_time;
+        int* arrival_time;
+        int* priority;
+        int* deadline;
+    };
+
+    static constexpr int NO_DEADLINE = -1;
+
+private:
+    static const size_t ALIGNMENT = 64;
+
+    void* arena;
+    int count;
+    InputColumns owned;
+    std::shared_ptr<const MappedFile> backing;
+
+    template <typename T>
+    static T* carve(char*& cursor, int rows) {
+        T* column = reinterpret_cast<T*>(cursor);
+        cursor += columnBytes(sizeof(T), rows);
+        return column;
+    }
+
+    static size_t columnBytes(size_t element_size, int rows) {
+        size_t bytes = element_size * static_cast<size_t>(rows);
+        return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    void release() {
+        if (arena) {
+            ::operator delete(arena, std::align_val_t(ALIGNMENT));
+            arena = nullptr;
+        }
+        owned = InputColumns{nullptr, nullptr, nullptr, nullptr, nullptr};
+        backing.reset();
+        cycles.reset();
+        count = 0;
+    }
+
+    // Allocate the arena, with room for `input_columns` owned input columns
+    char* allocateArena(int rows, int input_columns) {
+        release();
+        size_t bytes = columnBytes(sizeof(int), rows) +
+                       3 * columnBytes(sizeof(long long), rows) +
+                       input_columns * columnBytes(sizeof(int), rows);
+        arena = ::operator new(bytes > 0 ? bytes : ALIGNMENT,
+                               std::align_val_t(ALIGNMENT));
+        count = rows;
+
+        char* cursor = static_cast<char*>(arena);
+        remaining_time = carve<int>(cursor, rows);
+        waiting_time = carve<long long>(cursor, rows);
+        completion_time = carve<long long>(cursor, rows);
+        first_run = carve<long long>(cursor, rows);
+        return cursor;
+    }
+
+    void setInputs(const int* ids, const int* bursts, const int* arrivals,
+                   const int* priorities, const int* deadlines) {
+        id = ids;
+        burst_time = bursts;
+        arrival_time = arrivals;
+        priority = priorities;
+        deadline = deadlines;
+    }
+
+public:
+    // Input columns
+    const int* id;
+    const int* burst_time;
+    const int* arrival_time;
+    const int* priority;
+    const int* deadline;
+    std::shared_ptr<const BurstCycles> cycles;  // null unless the trace has I/O bursts
+
+    // Result columns, cleared by reset()
+    int* remaining_time;
+    long long* waiting_time;
+    long long* completion_time;
+    long long* first_run;  // -1 until the row is first dispatched
+    std::vector<long long> blocked_time;  // time on I/O, by row; empty without cycles
+
+    // Result counters, cleared by reset()
+    long long context_switches;
+    int last_dispatched;
+    std::vector<long long> device_busy;  // service time of each I/O device
+    long long io_busy;  // time at least one I/O device was busy
+
+    Timeline* timeline;  // records run slices when set
+
+    ProcessTable()
+        : arena(nullptr), count(0), owned{nullptr, nullptr, nullptr, nullptr, nullptr},
+          id(nullptr), burst_time(nullptr), arrival_time(nullptr), priority(nullptr),
+          deadline(nullptr), remaining_time(nullptr), waiting_time(nullptr), completion_time(nullptr),
+          first_run(nullptr), context_switches(0), last_dispatched(-1), io_busy(0),
+          timeline(nullptr) {}
+
+    ProcessTable(const ProcessTable&) = delete;
+    ProcessTable& operator=(const ProcessTable&) = delete;
+
+    ~ProcessTable() { release(); }
+
+    int size() const { return count; }
+    int capacity() const { return count; }
+
+    // Allocate every column; the caller fills in the returned inputs
+    InputColumns allocate(int rows) {
+        char* cursor = allocateArena(rows, 5);
+        owned.id = carve<int>(cursor, rows);
+        owned.burst_time = carve<int>(cursor, rows);
+        owned.arrival_time = carve<int>(cursor, rows);
+        owned.priority = carve<int>(cursor, rows);
+        owned.deadline = carve<int>(cursor, rows);
+        setInputs(owned.id, owned.burst_time, owned.arrival_time, owned.priority,
+                  owned.deadline);
+        return owned;
+    }
+
+    // Use input columns that live in a mapped file, already in arrival
+    // order. Without a deadline column no process has a deadline.
+    void attach(std::shared_ptr<const MappedFile> file, int rows, const int* ids,
+                const int* bursts, const int* arrivals, const int* priorities,
+                const int* deadlines) {
+        char* cursor = allocateArena(rows, deadlines ? 0 : 1);
+        if (!deadlines) {
+            owned.deadline = carve<int>(cursor, rows);
+            std::fill(owned.deadline, owned.deadline + rows, NO_DEADLINE);
+            deadlines = owned.deadline;
+        }
+        backing = std::move(file);
+        setInputs(ids, bursts, arrivals, priorities, deadlines);
+        reset();
+    }
+
+    // Give this table its own result columns over another table's input
+    // columns, so a worker thread can run an algorithm without copying the
+    // trace. The source table must outlive this one.
+    void shareInputs(const ProcessTable& source) {
+        allocateArena(source.size(), 0);
+        backing = source.backing;
+        cycles = source.cycles;
+        setInputs(source.id, source.burst_time, source.arrival_time, source.priority,
+                  source.deadline);
+        reset();
+    }
+
+    // Reorder the rows of an allocate()d table into stable arrival order.
+    // Traces are usually written in arrival order already, in which case
+    // this is a single scan.
+    void sortByArrival() {
+        if (std::is_sorted(arrival_time, arrival_time + count)) {
+            reset();
+            return;
+        }
+
+        std::vector<int> order(count);
+        for (int row = 0; row < count; row++) order[row] = row;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return arrival_time[a] < arrival_time[b];
+        });
+
+        // remaining_time is free until reset(), so it doubles as scratch
+        int* columns[] = {owned.id, owned.burst_time, owned.arrival_time, owned.priority,
+                          owned.deadline};
+        for (int* column : columns) {
+            for (int row = 0; row < count; row++) {
+                remaining_time[row] = column[order[row]];
+            }
+            std::memcpy(column, remaining_time, sizeof(int) * static_cast<size_t>(count));
+        }
+        reset();
+    }
+
+    void reset() {
+        context_switches = 0;
+        last_dispatched = -1;
+        device_busy.clear();
+        io_busy = 0;
+        size_t rows = static_cast<size_t>(count);
+        if (rows == 0) return;
+        std::memcpy(remaining_time, burst_time, rows * sizeof(int));
+        std::memset(waiting_time, 0, rows * sizeof(long long));
+        std::memset(completion_time, 0, rows * sizeof(long long));
+        std::memset(first_run, 0xff, rows * sizeof(long long));
+        if (!cycles) {
+            blocked_time.clear();
+            return;
+        }
+        blocked_time.assign(rows, 0);
+        for (int row = 0; row < count; row++) {
+            remaining_time[row] = cycles->bursts[cycles->start[id[row]]];
+        }
+    }
+
+    // Record that `row` is given the CPU at time `t`. Handing it to a
+    // different process than last time counts as a context switch.
+    void dispatch(int row, long long t) {
+        if (first_run[row] < 0) first_run[row] = t;
+        if (last_dispatched >= 0 && last_dispatched != row) context_switches++;
+        last_dispatched = row;
+    }
+};
+
+// Walks the table in arrival order and hands each row over once the clock
+// reaches its arrival time.
+class ArrivalCursor {
+private:
+    const ProcessTable& table;
+    int next;
+
+public:
+    // Rows before `first` are taken as admitted already
+    explicit ArrivalCursor(const ProcessTable& processes, int first = 0)
+        : table(processes), next(first) {}
+
+    template <typename Sink>
+    void admit(long long current_time, Sink sink) {
+        while (next < table.size() && table.arrival_time[next] <= current_time) {
+            sink(next++);
+        }
+    }
+
+    bool done() const { return next == table.size(); }
+    long long nextArrival() const { return table.arrival_time[next]; }
+    int position() const { return next; }
+
+    // `row` has finished a CPU burst at time `t`; without I/O bursts that
+    // is the whole process (see IoArrivals)
+    bool release(int, long long) { return true; }
+};
+
+// I/O devices serving one shared queue of requests, first come first
+// served or shortest request first. Requests must come in time order;
+// advance() completes the work due by a time, starting waiting requests
+// as devices free up, and finished requests are then taken in completion
+// order. A free request goes to the lowest-numbered idle device.
+class DevicePool {
+public:
+    enum Discipline { FCFS, SHORTEST_FIRST };
+
+    struct Finished {
+        long long time;
+        int row;
+    };
+
+private:
+    struct Request {
+        long long burst;
+        long long order;  // place in request order
+        int row;
+        bool operator>(const Request& other) const {
+            return burst != other.burst ? burst > other.burst : order > other.order;
+        }
+    };
+
+    struct Service {
+        long long end;
+        int device;
+        int row;
+        bool operator>(const Service& other) const {
+            return end != other.end ? end > other.end : device > other.device;
+        }
+    };
+
+    template <typename T>
+    using MinHeap = std::priority_queue<T, std::vector<T>, std::greater<T>>;
+
+    Discipline discipline;
+    std::vector<long long> busy;  // service time by device
+    MinHeap<int> free_devices;
+    MinHeap<Service> serving;
+    std::deque<Request> arrival_order;  // waiting requests under FCFS
+    MinHeap<Request> shortest;          // waiting requests under SHORTEST_FIRST
+    std::deque<Finished> finished;
+    long long requests;
+    long long busy_any;    // time at least one device was busy
+    long long busy_since;  // start of the current such stretch
+
+    bool waiting() const { return !arrival_order.empty() || !shortest.empty(); }
+
+    void start(const Request& request, long long t) {
+        int device = free_devices.top();
+        free_devices.pop();
+        busy[device] += request.burst;
+        serving.push(Service{t + request.burst, device, request.row});
+    }
+
+    Request nextWaiting() {
+        Request request;
+        if (discipline == FCFS) {
+            request = arrival_order.front();
+            arrival_order.pop_front();
+        } else {
+            request = shortest.top();
+            shortest.pop();
+        }
+        return request;
+    }
+
+public:
+    DevicePool(int devices, Discipline order)
+        : discipline(order), busy(devices, 0), requests(0), busy_any(0), busy_since(0) {
+        for (int device = 0; device < devices; device++) free_devices.push(device);
+    }
+
+    void advance(long long t) {
+        while (!serving.empty() && serving.top().end <= t) {
+            Service done = serving.top();
+            serving.pop();
+            free_devices.push(done.device);
+            finished.push_back(Finished{done.end, done.row});
+            if (waiting()) {
+                start(nextWaiting(), done.end);
+            } else if (serving.empty()) {
+                busy_any += done.end - busy_since;
+            }
+        }
+    }
+
+    void request(int row, long long burst, long long t) {
+        advance(t);
+        Request request{burst, requests++, row};
+        if (!free_devices.empty()) {
+            if (serving.empty()) busy_since = t;
+            start(request, t);
+        } else if (discipline == FCFS) {
+            arrival_order.push_back(request);
+        } else {
+            shortest.push(request);
+        }
+    }
+
+    // True when no request is waiting, in service or finished untaken
+    bool empty() const { return serving.empty() && finished.empty(); }
+
+    // When the next request finishes (or finished); not for an empty pool
+    long long nextFinish() const {
+        return !finished.empty() ? finished.front().time : serving.top().end;
+    }
+
+    bool hasFinished() const { return !finished.empty(); }
+
+    Finished takeFinished() {
+        Finished done = finished.front();
+        finished.pop_front();
+        return done;
+    }
+
+    const std::vector<long long>& busyTime() const { return busy; }
+    long long busyAnyTime() const { return busy_any; }
+};
+
+// Arrival source for a table with I/O bursts, in place of an ArrivalCursor.
+// When a process ends a CPU burst with bursts still to go, release() hands
+// its I/O burst to the devices and sets up its next CPU burst; it is
+// admitted again, like an arrival, once the I/O completes, so every
+// algorithm overlaps I/O with CPU work without knowing about it. Arrivals
+// and returns from I/O are admitted in time order, arrivals first on a tie.
+class IoArrivals {
+private:
+    ProcessTable& table;
+    const BurstCycles& cycles;
+    ArrivalCursor cursor;
+    DevicePool devices;
+    std::vector<long long> next_burst;  // by row: index of its next I/O burst
+    std::vector<long long> blocked_at;  // by row: when its I/O was requested
+
+public:
+    IoArrivals(ProcessTable& processes, int device_count, DevicePool::Discipline discipline)
+        : table(processes), cycles(*processes.cycles), cursor(processes),
+          devices(device_count, discipline), next_burst(processes.size()),
+          blocked_at(processes.size(), 0) {
+        for (int row = 0; row < table.size(); row++) {
+            next_burst[row] = cycles.start[table.id[row]] + 1;
+        }
+    }
+
+    template <typename Sink>
+    void admit(long long current_time, Sink sink) {
+        devices.advance(current_time);
+        while (devices.hasFinished()) {
+            cursor.admit(devices.nextFinish(), sink);
+            DevicePool::Finished done = devices.takeFinished();
+            table.blocked_time[done.row] += done.time - blocked_at[done.row];
+            sink(done.row);
+        }
+        cursor.admit(current_time, sink);
+    }
+
+    bool done() const { return cursor.done() && devices.empty(); }
+
+    long long nextArrival() const {
+        if (devices.empty()) return cursor.nextArrival();
+        if (cursor.done()) return devices.nextFinish();
+        return std::min(cursor.nextArrival(), devices.nextFinish());
+    }
+
+    // `row` has finished a CPU burst at time `t`. Returns true if that was
+    // its last one; otherwise the process is now blocked on I/O.
+    bool release(int row, long long t) {
+        long long next = next_burst[row];
+        if (next == cycles.start[table.id[row] + 1]) return true;
+        blocked_at[row] = t;
+        devices.request(row, cycles.bursts[next], t);
+        table.remaining_time[row] = cycles.bursts[next + 1];
+        next_burst[row] = next + 2;
+        return false;
+    }
+
+    // Copy the device figures into the table's result counters
+    void record() {
+        table.device_busy = devices.busyTime();
+        table.io_busy = devices.busyAnyTime();
+    }
+};
+
+// Indexed binary heap of ready rows. Compare(a, b) is true when row a
+// should run before row b. Every row's heap slot is tracked, so a key
+// change is sifted in place (decrease-key) instead of a pop and a push.
+template <typename Compare>
+class ReadyQueue {
+private:
+    std::vector<int> heap;
+    std::vector<int> position;  // heap slot per row, -1 if absent
+    Compare before;
+
+    void place(int slot, int row) {
+        heap[slot] = row;
+        position[row] = slot;
+    }
+
+    void siftUp(int slot) {
+        int row = heap[slot];
+        while (slot > 0) {
+            int parent = (slot - 1) / 2;
+            if (!before(row, heap[parent])) break;
+            place(slot, heap[parent]);
+            slot = parent;
+        }
+        place(slot, row);
+    }
+
+    void siftDown(int slot) {
+        int row = heap[slot];
+        int count = static_cast<int>(heap.size());
+        while (true) {
+            int child = 2 * slot + 1;
+            if (child >= count) break;
+            if (child + 1 < count && before(heap[child + 1], heap[child])) {
+                child++;
+            }
+            if (!before(heap[child], row)) break;
+            place(slot, heap[child]);
+            slot = child;
+        }
+        place(slot, row);
+    }
+
+public:
+    ReadyQueue(int capacity, Compare compare)
+        : position(capacity, -1), before(compare) {
+        heap.reserve(capacity);
+    }
+
+    // Make room for rows below `capacity`
+    void grow(int capacity) {
+        if (capacity > static_cast<int>(position.size())) position.resize(capacity, -1);
+    }
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return static_cast<int>(heap.size()); }
+    bool contains(int row) const { return position[row] >= 0; }
+    int top() const { return heap.front(); }
+
+    void push(int row) {
+        heap.push_back(row);
+        siftUp(static_cast<int>(heap.size()) - 1);
+    }
+
+    void pop() {
+        position[heap.front()] = -1;
+        int last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            place(0, last);
+            siftDown(0);
+        }
+    }
+
+    // Pass every row to visit(row), in heap order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (int row : heap) visit(row);
+    }
+
+    // Remove every row, passing each to sink(row) in heap order
+    template <typename Sink>
+    void drain(Sink sink) {
+        for (int row : heap) {
+            position[row] = -1;
+            sink(row);
+        }
+        heap.clear();
+    }
+
+    // The row's key moved towards the front of the queue
+    void decreaseKey(int row) {
+        siftUp(position[row]);
+    }
+
+    // The row's key changed in either direction
+    void update(int row) {
+        siftUp(position[row]);
+        siftDown(position[row]);
+    }
+};
+
+// Fixed-capacity FIFO over a power-of-two ring, so push and pop are a mask
+// and an increment.
+class RingBuffer {
+private:
+    std::vector<int> slots;
+    size_t mask;
+    size_t head;
+    size_t count;
+
+public:
+    explicit RingBuffer(size_t capacity) : mask(0), head(0), count(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    int front() const { return slots[head]; }
+
+    // Make room for at least `capacity` entries, keeping their order
+    void grow(size_t capacity) {
+        if (capacity <= slots.size()) return;
+        size_t size = slots.size();
+        while (size < capacity) size <<= 1;
+        std::vector<int> larger(size);
+        for (size_t i = 0; i < count; i++) larger[i] = slots[(head + i) & mask];
+        slots.swap(larger);
+        mask = size - 1;
+        head = 0;
+    }
+
+    void push_back(int row) {
+        slots[(head + count) & mask] = row;
+        count++;
+    }
+
+    // Pass every entry to visit(entry), front first
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (size_t i = 0; i < count; i++) visit(slots[(head + i) & mask]);
+    }
+
+    void pop_front() {
+        head = (head + 1) & mask;
+        count--;
+    }
+};
+
+// Binary indexed tree of non-negative weights by row, for weighted random
+// selection: changing a weight and finding the row that covers a point of
+// the running total are both O(log n).
+class FenwickTree {
+private:
+    std::vector<long long> tree;  // 1-based partial sums
+    int top_step;                 // highest power of two within the size
+    long long sum;
+
+public:
+    explicit FenwickTree(int size) : tree(size + 1, 0), top_step(1), sum(0) {
+        while (top_step * 2 <= size) top_step *= 2;
+    }
+
+    long long total() const { return sum; }
+
+    void add(int row, long long delta) {
+        sum += delta;
+        for (int i = row + 1; i < static_cast<int>(tree.size()); i += i & -i) tree[i] += delta;
+    }
+
+    // The first row whose prefix sum exceeds `target`, 0 <= target < total()
+    int find(long long target) const {
+        int position = 0;
+        for (int step = top_step; step > 0; step >>= 1) {
+            int next = position + step;
+            if (next < static_cast<int>(tree.size()) && tree[next] <= target) {
+                position = next;
+                target -= tree[next];
+            }
+        }
+        return position;
+    }
+};
+
+// Runs fn(task, worker) for every task in [0, tasks) on up to `threads`
+// threads, the calling thread included. Tasks are handed out through a
+// shared counter; `worker` is a stable index below the thread count. The
+// first exception a task throws stops the handing out of tasks and is
+// rethrown on the calling thread once every worker has finished.
+template <typename Fn>
+void parallelFor(int tasks, int threads, Fn fn) {
+    int thread_count = std::max(1, std::min(threads, tasks));
+    std::atomic<int> next_task(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto worker = [&](int worker_id) {
+        int task;
+        while ((task = next_task++) < tasks) {
+            try {
+                fn(task, worker_id);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next_task = tasks;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; i++) {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+// Like parallelFor, but the tasks are dealt round-robin onto per-worker
+// deques up front. A worker takes tasks from the front of its own deque
+// and, once that runs dry, steals from the back of the fullest other one,
+// so a worker stuck on a long task does not hold up the tasks queued behind
+// it. Meant for coarse tasks such as whole trace files, since every deque
+// is guarded by a mutex.
+template <typename Fn>
+void parallelForStealing(int tasks, int threads, Fn fn) {
+    struct Shard {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+    int thread_count = std::max(1, std::min(threads, tasks));
+    std::vector<Shard> shards(thread_count);
+    for (int task = 0; task < tasks; task++) {
+        shards[task % thread_count].tasks.push_back(task);
+    }
+
+    auto take = [&](int worker_id, int& task) {
+        {
+            std::lock_guard<std::mutex> lock(shards[worker_id].mutex);
+            if (!shards[worker_id].tasks.empty()) {
+                task = shards[worker_id].tasks.front();
+                shards[worker_id].tasks.pop_front();
+                return true;
+            }
+        }
+        while (true) {
+            int victim = -1;
+            size_t most = 0;
+            for (int i = 0; i < thread_count; i++) {
+                if (i == worker_id) continue;
+                std::lock_guard<std::mutex> lock(shards[i].mutex);
+                if (shards[i].tasks.size() > most) {
+                    most = shards[i].tasks.size();
+                    victim = i;
+                }
+            }
+            if (victim < 0) return false;
+
+            std::lock_guard<std::mutex> lock(shards[victim].mutex);
+            if (!shards[victim].tasks.empty()) {
+                task = shards[victim].tasks.back();
+                shards[victim].tasks.pop_back();
+                return true;
+            }
+        }
+    };
+    auto worker = [&](int worker_id) {
+        int task;
+        while (take(worker_id, task)) {
+            fn(task, worker_id);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; i++) {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+}
+
+// Parser for the colon-delimited `burst:arrival:priority[:deadline]` trace
+// format, the deadline being relative to arrival. The burst may instead be
+// a comma-separated `cpu,io,...,cpu` list of alternating CPU and I/O
+// bursts (see BurstCycles). The mapped text is split into chunks on
+// newline boundaries; a first pass counts records per chunk so the second
+// pass can parse every chunk in parallel straight into its rows of the
+// process table. Blank lines are skipped, anything else that does not
+// parse is reported with its line number.
+class TraceParser {
+private:
+    static const size_t MIN_CHUNK_BYTES = 1 << 20;
+    static const size_t MAX_REPORTED_ERRORS = 10;
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        long long first_line;  // 1-based line number of the chunk's first line
+        long long lines;
+        int first_row;
+        int records;
+        std::vector<std::string> errors;
+        std::vector<int> cycle_rows;  // rows given a burst list, in order
+        std::vector<size_t> cycle_ends;  // end of each row's list in cycle_bursts
+        std::vector<int> cycle_bursts;
+    };
+
+    static bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char* skipBlanks(const char* cursor, const char* end) {
+        while (cursor < end && isBlank(*cursor)) cursor++;
+        return cursor;
+    }
+
+    static const char* lineEnd(const char* cursor, const char* end) {
+        const void* newline = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+        return newline ? static_cast<const char*>(newline) : end;
+    }
+
+    static bool blankLine(const char* begin, const char* end) {
+        return skipBlanks(begin, end) == end;
+    }
+
+    static const char* parseField(const char* cursor, const char* end, int& value,
+                                  const char*& error) {
+        cursor = skipBlanks(cursor, end);
+        std::from_chars_result result = std::from_chars(cursor, end, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            error = "value out of range";
+            return nullptr;
+        }
+        if (result.ec != std::errc()) {
+            error = "expected burst:arrival:priority[:deadline]";
+            return nullptr;
+        }
+        return skipBlanks(result.ptr, end);
+    }
+
+    // The rest of a burst list whose first burst has been read into
+    // `burst`, which is left holding the total of the CPU bursts
+    static const char* parseCycle(const char* cursor, const char* end, int& burst,
+                                  std::vector<int>& cycle, const char*& error) {
+        cycle.assign(1, burst);
+        long long cpu_total = burst;
+        while (cursor < end && *cursor == ',') {
+            int value;
+            cursor = parseField(cursor + 1, end, value, error);
+            if (!cursor) return nullptr;
+            if (cycle.size() % 2 == 0) cpu_total += value;
+            cycle.push_back(value);
+        }
+        if (cycle.size() % 2 == 0) {
+            error = "burst list must end with a CPU burst";
+            return nullptr;
+        }
+        if (*std::min_element(cycle.begin(), cycle.end()) < 0) {
+            error = "burst time must not be negative";
+            return nullptr;
+        }
+        if (cpu_total > INT_MAX) {
+            error = "total CPU burst out of range";
+            return nullptr;
+        }
+        burst = static_cast<int>(cpu_total);
+        return cursor;
+    }
+
+    // Returns nullptr on success, otherwise what was wrong with the line.
+    // A burst list goes into `cycle` (left empty otherwise); without one
+    // a list is an error.
+    static const char* parseLine(const char* cursor, const char* end, int& burst,
+                                 int& arrival, int& priority, int& deadline,
+                                 std::vector<int>* cycle) {
+        const char* error = nullptr;
+        int* fields[] = {&burst, &arrival, &priority, &deadline};
+        deadline = ProcessTable::NO_DEADLINE;
+        if (cycle) cycle->clear();
+        for (int field = 0; field < 4; field++) {
+            if (field == 3 && cursor == end) break;
+            if (field > 0) {
+                if (cursor == end || *cursor != ':') {
+                    return "expected burst:arrival:priority[:deadline]";
+                }
+                cursor++;
+            }
+            cursor = parseField(cursor, end, *fields[field], error);
+            if (!cursor) return error;
+            if (field == 0 && cursor < end && *cursor == ',') {
+                if (!cycle) return "I/O bursts are not available in streaming mode";
+                cursor = parseCycle(cursor, end, burst, *cycle, error);
+                if (!cursor) return error;
+            }
+            if (field == 3 && deadline < 0) return "deadline must not be negative";
+        }
+        if (cursor != end) return "unexpected text after deadline";
+        if (burst < 0) return "burst time must not be negative";
+        return nullptr;
+    }
+
+    static void count(Chunk& chunk) {
+        chunk.lines = 0;
+        chunk.records = 0;
+        for (const char* line = chunk.begin; line < chunk.end; chunk.lines++) {
+            const char* end = lineEnd(line, chunk.end);
+            if (!blankLine(line, end)) chunk.records++;
+            line = end + 1;
+        }
+    }
+
+    static void parse(Chunk& chunk, const ProcessTable::InputColumns& table) {
+        int row = chunk.first_row;
+        long long line_number = chunk.first_line;
+        std::vector<int> cycle;
+        for (const char* line = chunk.begin; line < chunk.end; line_number++) {
+            const char* end = lineEnd(line, chunk.end);
+            if (!blankLine(line, end)) {
+                const char* error = parseLine(line, end, table.burst_time[row],
+                                              table.arrival_time[row], table.priority[row],
+                                              table.deadline[row], &cycle);
+                if (error && chunk.errors.size() < MAX_REPORTED_ERRORS) {
+                    chunk.errors.push_back("line " + std::to_string(line_number) + ": " + error);
+                }
+                if (!cycle.empty()) {
+                    chunk.cycle_rows.push_back(row);
+                    chunk.cycle_bursts.insert(chunk.cycle_bursts.end(), cycle.begin(), cycle.end());
+                    chunk.cycle_ends.push_back(chunk.cycle_bursts.size());
+                }
+                table.id[row] = row;
+                row++;
+            }
+            line = end + 1;
+        }
+    }
+
+public:
+    // Parse one line of a streamed trace, `end` excluding the newline.
+    // Returns false for a blank line and throws if the line is malformed.
+    static bool parseRecord(const char* begin, const char* end, long long line_number,
+                            int& burst, int& arrival, int& priority, int& deadline) {
+        if (blankLine(begin, end)) return false;
+        const char* error = parseLine(begin, end, burst, arrival, priority, deadline, nullptr);
+        if (error) {
+            throw std::runtime_error("Malformed input: line " + std::to_string(line_number) +
+                                     ": " + error);
+        }
+        return true;
+    }
+
+    // The BurstCycles of a trace with at least one burst list. Rows are
+    // still in input order here, so each row is its process id.
+    static std::shared_ptr<const BurstCycles> gatherCycles(
+        const std::vector<Chunk>& chunks, const ProcessTable::InputColumns& table) {
+        std::shared_ptr<BurstCycles> cycles = std::make_shared<BurstCycles>();
+        for (const Chunk& chunk : chunks) {
+            size_t listed = 0;
+            for (int row = chunk.first_row; row < chunk.first_row + chunk.records; row++) {
+                cycles->start.push_back(static_cast<long long>(cycles->bursts.size()));
+                if (listed < chunk.cycle_rows.size() && chunk.cycle_rows[listed] == row) {
+                    size_t first = listed > 0 ? chunk.cycle_ends[listed - 1] : 0;
+                    cycles->bursts.insert(cycles->bursts.end(),
+                                          chunk.cycle_bursts.begin() + first,
+                                          chunk.cycle_bursts.begin() + chunk.cycle_ends[listed]);
+                    listed++;
+                } else {
+                    cycles->bursts.push_back(table.burst_time[row]);
+                }
+            }
+        }
+        cycles->start.push_back(static_cast<long long>(cycles->bursts.size()));
+        return cycles;
+    }
+
+    static void load(const MappedFile& file, ProcessTable& table, int threads) {
+        const char* begin = file.data();
+        const char* end = begin + file.size();
+
+        // Cut the text into roughly equal chunks that end after a newline
+        std::vector<Chunk> chunks;
+        size_t chunk_count = std::max<size_t>(1, std::min<size_t>(
+            static_cast<size_t>(std::max(1, threads)) * 4, file.size() / MIN_CHUNK_BYTES));
+        size_t target = file.size() / chunk_count + 1;
+        for (const char* cursor = begin; cursor < end;) {
+            const char* stop = cursor + std::min(target, static_cast<size_t>(end - cursor));
+            if (stop < end) stop = lineEnd(stop, end);
+            if (stop < end) stop++;  // keep the newline with its line
+            Chunk chunk = {cursor, stop, 0, 0, 0, 0, {}, {}, {}, {}};
+            chunks.push_back(chunk);
+            cursor = stop;
+        }
+
+        int tasks = static_cast<int>(chunks.size());
+        parallelFor(tasks, threads, [&](int task, int) { count(chunks[task]); });
+
+        long long lines = 1;
+        long long rows = 0;
+        for (Chunk& chunk : chunks) {
+            chunk.first_line = lines;
+            chunk.first_row = static_cast<int>(rows);
+            lines += chunk.lines;
+            rows += chunk.records;
+        }
+        if (rows > INT_MAX) {
+            throw std::runtime_error("Input file has too many processes");
+        }
+
+        ProcessTable::InputColumns columns = table.allocate(static_cast<int>(rows));
+        parallelFor(tasks, threads, [&](int task, int) { parse(chunks[task], columns); });
+
+        std::string message;
+        size_t reported = 0;
+        for (const Chunk& chunk : chunks) {
+            for (const std::string& error : chunk.errors) {
+                if (reported++ < MAX_REPORTED_ERRORS) message += "\n  " + error;
+            }
+        }
+        if (reported > 0) {
+            throw std::runtime_error("Malformed input file:" + message);
+        }
+
+        for (const Chunk& chunk : chunks) {
+            if (!chunk.cycle_rows.empty()) {
+                table.cycles = gatherCycles(chunks, columns);
+                break;
+            }
+        }
+        table.sortByArrival();
+    }
+};
+
+// Versioned binary trace: a fixed header followed by the id, burst,
+// arrival, priority and deadline columns as 32-bit integers, each 64-byte
+// aligned and already in stable arrival order. The file is mapped and its
+// columns are used in place, so loading costs a header check and one
+// validating scan, with no copy. Version 1 files have no deadline column
+// and still load.
+class BinaryTrace {
+private:
+    static const uint32_t VERSION = 2;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const size_t ALIGNMENT = 64;
+    static const int COLUMNS = 5;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t count;
+        uint64_t column_offset[COLUMNS];  // id, burst, arrival, priority, deadline
+    };
+
+    // Version 1 headers stop after the priority column's offset
+    static int columnsIn(uint32_t version) { return version == 1 ? 4 : COLUMNS; }
+
+    static const char* magic() { return "CPE351TR"; }
+
+    static uint64_t alignUp(uint64_t offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+public:
+    static bool matches(const MappedFile& file) {
+        return file.size() >= sizeof(Header) &&
+               std::memcmp(file.data(), magic(), 8) == 0;
+    }
+
+    // Every id is a row number, bursts and deadlines are in range and
+    // arrivals never decrease, as the writer guarantees and the scheduler
+    // relies on
+    static bool valid(int rows, const int* const* columns) {
+        for (int row = 0; row < rows; row++) {
+            if (columns[0][row] < 0 || columns[0][row] >= rows) return false;
+            if (columns[1][row] < 0) return false;
+            if (row > 0 && columns[2][row] < columns[2][row - 1]) return false;
+            if (columns[4] && columns[4][row] < 0 &&
+                columns[4][row] != ProcessTable::NO_DEADLINE) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void load(std::shared_ptr<const MappedFile> file, ProcessTable& table) {
+        Header header;
+        std::memcpy(&header, file->data(), sizeof(Header));
+        if (header.byte_order != BYTE_ORDER_MARK) {
+            throw std::runtime_error("Binary trace was written with a different byte order");
+        }
+        if (header.version != VERSION && header.version != 1) {
+            throw std::runtime_error("Unsupported binary trace version " +
+                                     std::to_string(header.version));
+        }
+        if (header.count > static_cast<uint64_t>(INT_MAX)) {
+            throw std::runtime_error("Binary trace has too many processes");
+        }
+
+        const int* columns[COLUMNS] = {};
+        int present = columnsIn(header.version);
+        uint64_t header_bytes = offsetof(Header, column_offset) + present * sizeof(uint64_t);
+        uint64_t column_bytes = header.count * sizeof(int32_t);
+        for (int column = 0; column < present; column++) {
+            uint64_t offset = header.column_offset[column];
+            if (offset % ALIGNMENT != 0 || offset < header_bytes ||
+                offset > file->size() || file->size() - offset < column_bytes) {
+                throw std::runtime_error("Binary trace is truncated or corrupt");
+            }
+            columns[column] = reinterpret_cast<const int*>(file->data() + offset);
+        }
+
+        int rows = static_cast<int>(header.count);
+        if (!valid(rows, columns)) {
+            throw std::runtime_error("Binary trace is truncated or corrupt");
+        }
+        table.attach(std::move(file), rows, columns[0], columns[1], columns[2], columns[3],
+                     columns[4]);
+    }
+
+    static void write(const ProcessTable& table, const std::string& output_file) {
+        if (table.cycles) {
+            throw std::runtime_error("Binary traces cannot hold I/O bursts");
+        }
+        std::ofstream out(output_file, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not open output file");
+        }
+
+        Header header;
+        std::memset(&header, 0, sizeof(Header));
+        std::memcpy(header.magic, magic(), 8);
+        header.version = VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.count = static_cast<uint64_t>(table.size());
+
+        uint64_t column_bytes = header.count * sizeof(int32_t);
+        uint64_t offset = alignUp(sizeof(Header));
+        for (int column = 0; column < COLUMNS; column++) {
+            header.column_offset[column] = offset;
+            offset = alignUp(offset + column_bytes);
+        }
+
+        const int* columns[COLUMNS] = {table.id, table.burst_time, table.arrival_time,
+                                       table.priority, table.deadline};
+        static const char padding[ALIGNMENT] = {};
+        uint64_t written = sizeof(Header);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        for (int column = 0; column < COLUMNS; column++) {
+            out.write(padding, static_cast<std::streamsize>(header.column_offset[column] - written));
+            out.write(reinterpret_cast<const char*>(columns[column]),
+                      static_cast<std::streamsize>(column_bytes));
+            written = header.column_offset[column] + column_bytes;
+        }
+        if (!out) {
+            throw std::runtime_error("Could not write binary trace");
+        }
+    }
+};
+
+// Output file plus, unless echo is off, the console. Writes go straight to
+// the file descriptors so large blocks cost one system call each.
+class ResultWriter {
+private:
+    int fd;
+    bool echo;
+
+    static void writeAll(int target, const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = ::write(target, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Could not write results");
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+public:
+    ResultWriter(const std::string& output_file, bool echo_to_console)
+        : fd(-1), echo(echo_to_console) {
+        fd = open(output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open output file");
+        }
+    }
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    ~ResultWriter() {
+        if (fd >= 0) close(fd);
+    }
+
+    void write(const char* data, size_t length) {
+        writeAll(fd, data, length);
+        if (echo) writeAll(STDOUT_FILENO, data, length);
+    }
+};
+
+// Reusable formatting buffer. Numbers are appended with std::to_chars; when
+// a writer is attached the buffer is flushed to it whenever it fills up,
+// otherwise it grows to hold everything appended since the last clear().
+class OutputBuffer {
+private:
+    static const size_t FLUSH_BYTES = 1 << 20;
+
+    std::vector<char> bytes;
+    size_t used;
+    size_t handed_off;  // bytes already flushed or written out
+    ResultWriter* sink;
+
+    char* reserve(size_t length) {
+        if (used + length > bytes.size()) {
+            if (sink && used > 0) {
+                flush();
+            }
+            if (used + length > bytes.size()) {
+                bytes.resize(std::max(bytes.size() * 2, used + length));
+            }
+        }
+        return bytes.data() + used;
+    }
+
+public:
+    explicit OutputBuffer(ResultWriter* writer = nullptr)
+        : bytes(FLUSH_BYTES), used(0), handed_off(0), sink(writer) {}
+
+    void append(char c) {
+        *reserve(1) = c;
+        used++;
+    }
+
+    void append(long long value) {
+        char* cursor = reserve(24);
+        used = static_cast<size_t>(std::to_chars(cursor, cursor + 24, value).ptr - bytes.data());
+    }
+
+    void append(const char* text, size_t length) {
+        std::memcpy(reserve(length), text, length);
+        used += length;
+    }
+
+    void flush() {
+        if (sink && used > 0) sink->write(bytes.data(), used);
+        handed_off += used;
+        used = 0;
+    }
+
+    void writeTo(ResultWriter& writer) {
+        writer.write(bytes.data(), used);
+        handed_off += used;
+        used = 0;
+    }
+
+    // Bytes appended since construction
+    size_t total() const { return handed_off + used; }
+};
+
+// Hands filled buffers to a thread that writes them to a file, so the
+// producer only blocks when MAX_PENDING buffers are already queued. Write
+// errors surface from finish().
+class BackgroundWriter {
+private:
+    static const size_t CHUNK_BYTES = 1 << 20;
+    static const size_t MAX_PENDING = 4;
+
+    ResultWriter writer;
+    std::vector<char> current;
+    std::deque<std::vector<char>> pending;
+    std::vector<std::vector<char>> spare;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool closing;
+    std::exception_ptr error;
+    std::thread thread;
+
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return closing || !pending.empty(); });
+            if (pending.empty()) return;
+            std::vector<char> chunk = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            if (!error) {
+                try {
+                    writer.write(chunk.data(), chunk.size());
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            chunk.clear();
+            lock.lock();
+            spare.push_back(std::move(chunk));
+            changed.notify_all();
+        }
+    }
+
+    void submit() {
+        if (current.empty()) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return pending.size() < MAX_PENDING; });
+        pending.push_back(std::move(current));
+        if (!spare.empty()) {
+            current = std::move(spare.back());
+            spare.pop_back();
+        } else {
+            current = std::vector<char>();
+            current.reserve(CHUNK_BYTES);
+        }
+        changed.notify_all();
+    }
+
+public:
+    explicit BackgroundWriter(const std::string& file)
+        : writer(file, false), closing(false) {
+        current.reserve(CHUNK_BYTES);
+        thread = std::thread([this]() { drain(); });
+    }
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    ~BackgroundWriter() {
+        try {
+            finish();
+        } catch (...) {
+        }
+    }
+
+    void append(const char* data, size_t length) {
+        if (current.size() + length > CHUNK_BYTES) submit();
+        current.insert(current.end(), data, data + length);
+    }
+
+    // Write out everything appended so far and stop the thread
+    void finish() {
+        if (!thread.joinable()) return;
+        submit();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        changed.notify_all();
+        thread.join();
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// Records which process ran on which CPU and when. Back-to-back slices of
+// one process on a CPU are merged, so what gets written is one slice per
+// dispatch. Each algorithm run is a section of the timeline.
+//
+// CHROME writes trace_event JSON for chrome://tracing or Perfetto, one
+// track (pid) per algorithm and one thread (tid) per CPU, with one time
+// unit shown as one microsecond. BINARY writes "CPE351TL", a uint32
+// version (1), then a stream of LEB128 varints. A section starts with 0,
+// the algorithm id, the name length and the name bytes. A slice is
+// cpu + 1, then the zigzag-encoded difference from the previous slice's id
+// and from the previous slice's end to this start, then the duration;
+// the previous slice counts as id 0 ending at 0 at each section start.
+class Timeline {
+public:
+    enum Format { CHROME, BINARY };
+
+private:
+    struct Slice {
+        int id;  // -1 for none
+        long long start;
+        long long end;
+    };
+
+    BackgroundWriter out;
+    Format format;
+    std::vector<Slice> open_slices;  // per CPU
+    int section;
+    bool first_event;
+    int previous_id;
+    long long previous_end;
+
+    void varint(uint64_t value) {
+        char bytes[10];
+        size_t length = 0;
+        while (value >= 0x80) {
+            bytes[length++] = static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        bytes[length++] = static_cast<char>(value);
+        out.append(bytes, length);
+    }
+
+    void zigzag(long long value) {
+        varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void event(const char* text, int length) {
+        if (!first_event) out.append(",\n", 2);
+        first_event = false;
+        out.append(text, static_cast<size_t>(length));
+    }
+
+    void emit(int cpu, const Slice& slice) {
+        if (format == BINARY) {
+            varint(static_cast<uint64_t>(cpu) + 1);
+            zigzag(static_cast<long long>(slice.id) - previous_id);
+            zigzag(slice.start - previous_end);
+            varint(static_cast<uint64_t>(slice.end - slice.start));
+            previous_id = slice.id;
+            previous_end = slice.end;
+            return;
+        }
+        char text[160];
+        int length = std::snprintf(text, sizeof(text),
+            "{\"name\":\"P%d\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+            slice.id + 1, section, cpu, slice.start, slice.end - slice.start);
+        event(text, length);
+    }
+
+    void closeSlices() {
+        for (size_t cpu = 0; cpu < open_slices.size(); cpu++) {
+            if (open_slices[cpu].id >= 0) emit(static_cast<int>(cpu), open_slices[cpu]);
+            open_slices[cpu].id = -1;
+        }
+    }
+
+public:
+    Timeline(const std::string& file, Format timeline_format)
+        : out(file), format(timeline_format), section(0), first_event(true),
+          previous_id(0), previous_end(0) {
+        if (format == BINARY) {
+            uint32_t version = 1;
+            out.append("CPE351TL", 8);
+            out.append(reinterpret_cast<const char*>(&version), sizeof(version));
+        } else {
+            out.append("{\"traceEvents\":[\n", 17);
+        }
+    }
+
+    // Start the section for one algorithm run
+    void begin(int algorithm_id, const char* name) {
+        closeSlices();
+        section = algorithm_id;
+        previous_id = 0;
+        previous_end = 0;
+        if (format == BINARY) {
+            size_t length = std::strlen(name);
+            varint(0);
+            varint(static_cast<uint64_t>(algorithm_id));
+            varint(length);
+            out.append(name, length);
+            return;
+        }
+        char text[160];
+        int length = std::snprintf(text, sizeof(text),
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%d %s\"}}",
+            algorithm_id, algorithm_id, name);
+        event(text, length);
+    }
+
+    // Process `id` ran on `cpu` from `start` to `end`
+    void record(int id, long long start, long long end, int cpu = 0) {
+        if (end <= start) return;
+        if (static_cast<size_t>(cpu) >= open_slices.size()) {
+            open_slices.resize(static_cast<size_t>(cpu) + 1, Slice{-1, 0, 0});
+        }
+        Slice& slice = open_slices[cpu];
+        if (slice.id == id && slice.end == start) {
+            slice.end = end;
+            return;
+        }
+        if (slice.id >= 0) emit(cpu, slice);
+        slice = Slice{id, start, end};
+    }
+
+    void finish() {
+        closeSlices();
+        if (format == CHROME) out.append("\n]}\n", 4);
+        out.finish();
+    }
+};
+
+// Streaming quantile estimate for non-negative integers, in the style of
+// DDSketch. A value v lands in bucket ceil(log_gamma(v)), so any estimate
+// is within 1% of a value of the requested rank, and memory is a fixed set
+// of counters no matter how many values are added. Buckets are narrower
+// than 1 below ~50, so small values come back exactly.
+class QuantileSketch {
+private:
+    static constexpr double ALPHA = 0.01;  // relative accuracy
+    static constexpr int BUCKETS = 2200;   // log_gamma(LLONG_MAX) < 2200
+
+    std::vector<uint64_t> buckets;
+    uint64_t zeros;
+    uint64_t total;
+    long long max_value;
+    double gamma;
+    double log_gamma;
+
+public:
+    QuantileSketch()
+        : buckets(BUCKETS, 0), zeros(0), total(0), max_value(0),
+          gamma((1 + ALPHA) / (1 - ALPHA)), log_gamma(std::log(gamma)) {}
+
+    void add(long long value) {
+        total++;
+        if (value <= 0) {
+            zeros++;
+            return;
+        }
+        max_value = std::max(max_value, value);
+        int index = static_cast<int>(std::ceil(std::log(static_cast<double>(value)) / log_gamma));
+        buckets[std::min(index, BUCKETS - 1)]++;
+    }
+
+    // Estimate of the q-quantile, 0 <= q <= 1, by nearest rank
+    long long quantile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+        if (rank == 0) rank = 1;
+        uint64_t seen = zeros;
+        if (seen >= rank) return 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                double estimate = 2 * std::pow(gamma, i) / (gamma + 1);
+                return std::min(std::llround(estimate), max_value);
+            }
+        }
+        return max_value;
+    }
+};
+
+// How closely a run gave processes the CPU in proportion to their tickets,
+// for the proportional-share algorithms. The reference is ideal fluid
+// sharing: while in the system (arrival to completion) a process is owed
+// tickets / T of the CPU, T being the tickets of every process in the
+// system, so it is owed its tickets times the integral of 1/T over its
+// stay. What it got is its burst. `error` is the total |burst - owed| over
+// twice the total burst, the fraction of CPU time that went to the wrong
+// process; `max_lag` is the largest |burst - owed| of one process.
+struct ShareAccuracy {
+    bool measured;
+    double error;
+    double max_lag;
+
+    // Tickets of a process for lottery and stride scheduling: its priority,
+    // at least 1
+    static int tickets(int priority) { return std::max(1, priority); }
+
+    ShareAccuracy() : measured(false), error(0), max_lag(0) {}
+
+    explicit ShareAccuracy(const ProcessTable& table) : measured(true), error(0), max_lag(0) {
+        struct Event {
+            long long time;
+            bool arrival;
+            int row;
+        };
+        int rows = table.size();
+        std::vector<Event> events;
+        events.reserve(2 * static_cast<size_t>(rows));
+        for (int row = 0; row < rows; row++) {
+            events.push_back(Event{table.arrival_time[row], true, row});
+            events.push_back(Event{table.completion_time[row], false, row});
+        }
+        // Arrivals first on a tie, so a process that leaves as it comes is
+        // owed nothing
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+            return a.time != b.time ? a.time < b.time : a.arrival > b.arrival;
+        });
+
+        std::vector<long double> joined(rows);  // per-ticket share at arrival
+        long double per_ticket = 0;
+        long long held = 0;
+        long long last = events.empty() ? 0 : events.front().time;
+        long double total_burst = 0, total_gap = 0;
+        for (const Event& event : events) {
+            if (held > 0) per_ticket += static_cast<long double>(event.time - last) / held;
+            last = event.time;
+            int tickets_held = tickets(table.priority[event.row]);
+            if (event.arrival) {
+                held += tickets_held;
+                joined[event.row] = per_ticket;
+                continue;
+            }
+            held -= tickets_held;
+            long double owed = tickets_held * (per_ticket - joined[event.row]);
+            long double gap = std::fabs(table.burst_time[event.row] - owed);
+            total_burst += table.burst_time[event.row];
+            total_gap += gap;
+            max_lag = std::max(max_lag, static_cast<double>(gap));
+        }
+        error = total_burst > 0 ? static_cast<double>(total_gap / (2 * total_burst)) : 0.0;
+    }
+};
+
+// Summary figures for one algorithm run, built up one finished process at
+// a time. Sums are exact; waiting and turnaround percentiles come from
+// sketches, so measuring a run needs no per-process storage. Lateness is
+// how long after its deadline a process completed, 0 if it made it.
+// Waiting leaves out time blocked on I/O. For a trace with I/O bursts the
+// device figures are copied from the table, and `in_system` is the time
+// at least one process had arrived and not completed: the CPU or a device
+// is busy for all of it, so the two overlap for busy_time + io_busy -
+// in_system.
+struct RunMetrics {
+    int processes;
+    long long start;  // first arrival, or time 0 if that is earlier
+    long long last_completion;
+    long long busy_time;
+    long long context_switches;
+    long double total_waiting;
+    long double total_turnaround;
+    long double total_response;  // arrival to first dispatch
+    QuantileSketch waiting;
+    QuantileSketch turnaround;
+    int deadlines;  // processes that have one
+    int deadline_misses;
+    long double total_lateness;
+    long long max_lateness;
+    ShareAccuracy shares;  // measured for lottery and stride only
+    std::vector<long long> device_busy;  // empty without I/O bursts
+    long long io_busy;
+    long long in_system;
+
+    RunMetrics()
+        : processes(0), start(LLONG_MAX), last_completion(0), busy_time(0), context_switches(0),
+          total_waiting(0), total_turnaround(0), total_response(0), deadlines(0),
+          deadline_misses(0), total_lateness(0), max_lateness(0), io_busy(0), in_system(0) {}
+
+    explicit RunMetrics(const ProcessTable& table) : RunMetrics() {
+        bool io = !table.blocked_time.empty();
+        for (int row = 0; row < table.size(); row++) {
+            add(table.arrival_time[row], table.burst_time[row], table.first_run[row],
+                table.completion_time[row], table.deadline[row],
+                io ? table.blocked_time[row] : 0);
+        }
+        context_switches = table.context_switches;
+        if (!io) return;
+
+        device_busy = table.device_busy;
+        io_busy = table.io_busy;
+        // Rows are in arrival order, so their spans merge in one pass
+        long long span_start = 0, span_end = LLONG_MIN;
+        for (int row = 0; row < table.size(); row++) {
+            long long arrival = std::max(0LL, static_cast<long long>(table.arrival_time[row]));
+            if (arrival > span_end) {
+                if (span_end > span_start) in_system += span_end - span_start;
+                span_start = arrival;
+                span_end = arrival;
+            }
+            span_end = std::max(span_end, table.completion_time[row]);
+        }
+        if (span_end > span_start) in_system += span_end - span_start;
+    }
+
+    void add(long long arrival, long long burst, long long first_run, long long completion,
+             int deadline, long long blocked) {
+        if (deadline != ProcessTable::NO_DEADLINE) {
+            long long lateness = completion - (arrival + deadline);
+            deadlines++;
+            if (lateness > 0) {
+                deadline_misses++;
+                total_lateness += lateness;
+                max_lateness = std::max(max_lateness, lateness);
+            }
+        }
+        long long turnaround_time = completion - arrival;
+        processes++;
+        start = std::min(start, std::max(0LL, arrival));
+        last_completion = std::max(last_completion, completion);
+        busy_time += burst;
+        total_waiting += turnaround_time - burst - blocked;
+        total_turnaround += turnaround_time;
+        total_response += first_run - arrival;
+        waiting.add(turnaround_time - burst - blocked);
+        turnaround.add(turnaround_time);
+    }
+
+    long long makespan() const {
+        return processes > 0 ? std::max(0LL, last_completion - start) : 0;
+    }
+};
+
+// Synthetic workload description for the trace generator
+struct WorkloadSpec {
+    enum Arrivals { POISSON, STORM };
+    enum Bursts { EXPONENTIAL, PARETO };
+    enum Priorities { UNIFORM, SKEWED, CONSTANT };
+
+    std::string name;
+    Arrivals arrivals;
+    Bursts bursts;
+    Priorities priorities;
+    int priority_levels;
+    double mean_burst;
+    double load;  // offered CPU load: mean burst / mean inter-arrival time
+    uint64_t seed;
+    double deadline_slack;  // deadline as a multiple of the burst, 0 for none
+};
+
+// Deterministic trace generator. Only std::mt19937_64, whose output is fixed
+// by the standard, is taken from <random>; the distributions are sampled by
+// inverse transform here so a seed gives the same trace on every platform.
+class WorkloadGenerator {
+private:
+    static const int STORM_SPEEDUP = 20;
+    static const int PARETO_CAP = 1000;  // in multiples of the mean burst
+
+    const WorkloadSpec& spec;
+    std::mt19937_64 random;
+
+    // Uniform on (0, 1]
+    double uniform() {
+        return (static_cast<double>(random() >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+    }
+
+    double exponential(double mean) {
+        return -mean * std::log(uniform());
+    }
+
+    int burst() {
+        double value;
+        if (spec.bursts == WorkloadSpec::PARETO) {
+            // Shape 1.5; the scale is picked so the mean is spec.mean_burst
+            const double shape = 1.5;
+            double scale = spec.mean_burst * (shape - 1) / shape;
+            value = std::min(scale / std::pow(uniform(), 1 / shape),
+                             spec.mean_burst * PARETO_CAP);
+        } else {
+            value = exponential(spec.mean_burst);
+        }
+        return std::max(1, static_cast<int>(value + 0.5));
+    }
+
+    int priority() {
+        switch (spec.priorities) {
+            case WorkloadSpec::UNIFORM:
+                return static_cast<int>(random() % static_cast<uint64_t>(spec.priority_levels));
+            case WorkloadSpec::SKEWED: {
+                // Geometric: each level is half as likely as the one below
+                int level = 0;
+                while (level + 1 < spec.priority_levels && (random() & 1)) level++;
+                return level;
+            }
+            default:
+                return 0;
+        }
+    }
+
+public:
+    explicit WorkloadGenerator(const WorkloadSpec& workload)
+        : spec(workload), random(workload.seed) {}
+
+    void generate(int count, ProcessTable& table) {
+        ProcessTable::InputColumns columns = table.allocate(count);
+        double mean_gap = spec.mean_burst / spec.load;
+        double clock = 0;
+
+        // Storms: runs of ~200 arrivals STORM_SPEEDUP times denser than
+        // normal, between calm spells of ~100 arrivals spaced 2.9 gaps apart,
+        // so over a storm/calm cycle the mean gap (and load) is unchanged.
+        bool storm = false;
+        int episode_left = 0;
+
+        for (int row = 0; row < count; row++) {
+            double gap = mean_gap;
+            if (spec.arrivals == WorkloadSpec::STORM) {
+                if (episode_left-- <= 0) {
+                    storm = !storm;
+                    episode_left = 1 + static_cast<int>(exponential(storm ? 200 : 100));
+                }
+                gap = storm ? mean_gap / STORM_SPEEDUP : mean_gap * 2.9;
+            }
+            clock += exponential(gap);
+            if (clock > INT_MAX) {
+                throw std::runtime_error("Generated trace does not fit 32-bit arrival times");
+            }
+
+            columns.id[row] = row;
+            columns.arrival_time[row] = static_cast<int>(clock);
+            columns.burst_time[row] = burst();
+            columns.priority[row] = priority();
+            columns.deadline[row] = ProcessTable::NO_DEADLINE;
+            if (spec.deadline_slack > 0) {
+                columns.deadline[row] = static_cast<int>(std::min<double>(
+                    std::ceil(spec.deadline_slack * columns.burst_time[row]), INT_MAX));
+            }
+        }
+        table.reset();
+    }
+};
+
+// Per-core results of a multi-CPU run
+struct CoreReport {
+    std::vector<long long> busy_time;  // per core, including migration cost
+    long long makespan;
+    long long steals;
+    long long migrations;
+};
+
+// Multi-CPU simulation with one run queue per core. A process is queued on
+// its home core (id modulo the core count); a core that runs out of work,
+// once every idle core has taken from its own queue, steals the next
+// process from the core with the longest queue. Running
+// away from the home core, or from the core a Round Robin process last ran
+// on, costs `migration_cost` time units before the process makes progress.
+//
+// FCFS, SJF and Priority run to completion; Round Robin puts an expired
+// process back on the queue of the core it ran on.
+class MulticoreScheduler {
+public:
+    enum Policy { FCFS, SJF, PRIORITY, ROUND_ROBIN };
+
+private:
+    // Run-queue order: the policy key, then the id, then the row
+    typedef std::tuple<long long, int, int> QueueEntry;
+
+    struct Core {
+        std::set<QueueEntry> queue;
+        int running;  // row, -1 when idle
+        int last;     // row that ran last, -1 before the first dispatch
+        long long slice;
+    };
+
+    ProcessTable& table;
+    int cpus;
+    int quantum;
+    long long migration_cost;
+
+public:
+    MulticoreScheduler(ProcessTable& processes, int cpu_count, int time_quantum,
+                       long long migration)
+        : table(processes), cpus(cpu_count), quantum(time_quantum),
+          migration_cost(migration) {}
+
+    CoreReport run(Policy policy) {
+        std::vector<Core> cores(cpus);
+        std::vector<int> last_core(table.size(), -1);
+        CoreReport report;
+        report.busy_time.assign(cpus, 0);
+        report.makespan = 0;
+        report.steals = 0;
+        report.migrations = 0;
+
+        // Core-free events, earliest first, ties by core index
+        std::priority_queue<std::pair<long long, int>, std::vector<std::pair<long long, int>>,
+                            std::greater<std::pair<long long, int>>> free_events;
+        for (Core& core : cores) core.running = core.last = -1;
+
+        ArrivalCursor arrivals(table);
+        std::vector<std::pair<int, int>> expired;  // (core, row)
+        long long sequence = 0;  // FIFO order for FCFS and Round Robin
+        long long current_time = 0;
+        int completed = 0;
+
+        auto enqueue = [&](int core, int row) {
+            long long key;
+            switch (policy) {
+                case SJF: key = table.remaining_time[row]; break;
+                case PRIORITY: key = -static_cast<long long>(table.priority[row]); break;
+                default: key = sequence++; break;
+            }
+            cores[core].queue.insert(QueueEntry(key, table.id[row], row));
+        };
+
+        auto admit = [&](int row) {
+            last_core[row] = table.id[row] % cpus;
+            enqueue(last_core[row], row);
+        };
+
+        // Start `row`, taken off a run queue, on idle core `index`
+        auto dispatch = [&](int index, int row) {
+            Core& core = cores[index];
+            long long overhead = 0;
+            if (last_core[row] != index) {
+                overhead = migration_cost;
+                report.migrations++;
+            }
+            last_core[row] = index;
+
+            if (table.first_run[row] < 0) table.first_run[row] = current_time + overhead;
+            if (core.last >= 0 && core.last != row) table.context_switches++;
+            core.last = row;
+            core.running = row;
+            core.slice = table.remaining_time[row];
+            if (policy == ROUND_ROBIN && core.slice > quantum) core.slice = quantum;
+            report.busy_time[index] += overhead + core.slice;
+            if (table.timeline) {
+                table.timeline->record(table.id[row], current_time + overhead,
+                                       current_time + overhead + core.slice, index);
+            }
+            free_events.push(std::make_pair(current_time + overhead + core.slice, index));
+        };
+        auto take = [](Core& source) {
+            int row = std::get<2>(*source.queue.begin());
+            source.queue.erase(source.queue.begin());
+            return row;
+        };
+
+        while (completed != table.size()) {
+            // Finish every slice that ends now
+            while (!free_events.empty() && free_events.top().first == current_time) {
+                int index = free_events.top().second;
+                free_events.pop();
+                Core& core = cores[index];
+                int row = core.running;
+                core.running = -1;
+                table.remaining_time[row] -= static_cast<int>(core.slice);
+                if (table.remaining_time[row] == 0) {
+                    table.completion_time[row] = current_time;
+                    table.waiting_time[row] = current_time - table.arrival_time[row] -
+                                              table.burst_time[row];
+                    report.makespan = std::max(report.makespan, current_time);
+                    completed++;
+                } else {
+                    expired.push_back(std::make_pair(index, row));
+                }
+            }
+
+            // Arrivals queue ahead of processes whose quantum just expired,
+            // as on a single CPU
+            arrivals.admit(current_time, admit);
+            for (const std::pair<int, int>& entry : expired) {
+                enqueue(entry.first, entry.second);
+            }
+            expired.clear();
+
+            // Hand idle cores their own work first, so no core steals what
+            // an idle home core would have run now
+            for (int index = 0; index < cpus; index++) {
+                Core& core = cores[index];
+                if (core.running < 0 && !core.queue.empty()) dispatch(index, take(core));
+            }
+            // Then cores still idle steal from the longest queue
+            for (int index = 0; index < cpus; index++) {
+                if (cores[index].running >= 0) continue;
+                Core* source = &cores[index];
+                for (Core& victim : cores) {
+                    if (victim.queue.size() > source->queue.size()) source = &victim;
+                }
+                if (source->queue.empty()) break;
+                report.steals++;
+                dispatch(index, take(*source));
+            }
+
+            if (completed == table.size()) break;
+
+            long long next_time = LLONG_MAX;
+            if (!free_events.empty()) next_time = free_events.top().first;
+            if (!arrivals.done()) next_time = std::min(next_time, arrivals.nextArrival());
+            current_time = next_time;
+        }
+        return report;
+    }
+};
+
+// Reads `burst:arrival:priority[:deadline]` records from a pipe, FIFO or
+// file as they come in, for streaming mode. Records must be in arrival
+// order unless acceptAnyOrder was called. Only the unread part of the
+// input is buffered; `waiting` is called before every read that may
+// block, so output can be flushed first.
+class TraceStream {
+private:
+    static const size_t READ_BYTES = 1 << 16;
+
+    int fd;
+    bool owned;
+    std::vector<char> buffer;
+    size_t begin;
+    size_t end;
+    bool eof;
+    long long line_number;
+    long long last_arrival;
+    int next_id;
+    bool ordered;
+    std::function<void()> waiting;
+
+    void fill() {
+        if (begin > 0) {
+            std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        if (buffer.size() - end < READ_BYTES) buffer.resize(end + READ_BYTES);
+        if (waiting) waiting();
+
+        ssize_t got;
+        do {
+            got = ::read(fd, buffer.data() + end, buffer.size() - end);
+        } while (got < 0 && errno == EINTR);
+        if (got < 0) {
+            throw std::runtime_error("Could not read input");
+        }
+        if (got == 0) eof = true;
+        end += static_cast<size_t>(got);
+    }
+
+    // The next line without its newline; false at the end of the input
+    bool nextLine(const char*& line, const char*& line_end) {
+        while (true) {
+            const char* start = buffer.data() + begin;
+            const void* newline = std::memchr(start, '\n', end - begin);
+            if (newline) {
+                line = start;
+                line_end = static_cast<const char*>(newline);
+                begin = static_cast<size_t>(line_end - buffer.data()) + 1;
+                return true;
+            }
+            if (eof) {
+                if (begin == end) return false;
+                line = start;
+                line_end = buffer.data() + end;
+                begin = end;
+                return true;
+            }
+            fill();
+        }
+    }
+
+public:
+    // "-" reads standard input
+    explicit TraceStream(const std::string& input_file)
+        : fd(STDIN_FILENO), owned(false), buffer(READ_BYTES), begin(0), end(0), eof(false),
+          line_number(0), last_arrival(LLONG_MIN), next_id(0), ordered(true) {
+        if (input_file != "-") {
+            fd = open(input_file.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("Could not open input file");
+            }
+            owned = true;
+        }
+    }
+
+    TraceStream(const TraceStream&) = delete;
+    TraceStream& operator=(const TraceStream&) = delete;
+
+    ~TraceStream() {
+        if (owned) close(fd);
+    }
+
+    void onWait(std::function<void()> callback) { waiting = std::move(callback); }
+
+    // Let records come in any order, for a reader that sorts them
+    void acceptAnyOrder() { ordered = false; }
+
+    // The next record and its id (input order); false at the end of input
+    bool next(int& id, int& burst, int& arrival, int& priority, int& deadline) {
+        const char* line;
+        const char* line_end;
+        while (nextLine(line, line_end)) {
+            line_number++;
+            if (!TraceParser::parseRecord(line, line_end, line_number, burst, arrival, priority,
+                                          deadline)) {
+                continue;
+            }
+            if (ordered && arrival < last_arrival) {
+                throw std::runtime_error("Line " + std::to_string(line_number) +
+                                         ": streamed processes must be in arrival order");
+            }
+            last_arrival = arrival;
+            id = next_id++;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Sorts a streamed trace into arrival order within a memory budget, for
+// streaming mode over input that is not arrival-ordered. Records are read
+// into a buffer of `memory_budget` bytes; a trace that fits is sorted in
+// place. Otherwise each full buffer is sorted and spilled as a run to an
+// unlinked temporary file in $TMPDIR (default /tmp), and the runs are
+// merged k ways, with extra passes when the budget cannot give every run
+// a read buffer. Records keep their input-order id, so equal arrivals stay
+// in input order and results carry the original process numbers.
+class ArrivalSort {
+private:
+    struct Record {
+        int arrival;
+        int id;
+        int burst;
+        int priority;
+        int deadline;
+    };
+
+    struct Run {
+        off_t offset;  // bytes into the spill file
+        long long count;
+    };
+
+    // Sorted records read back from a run, a buffer at a time
+    struct RunReader {
+        off_t offset;
+        long long left;  // records not yet in the buffer
+        std::vector<Record> buffer;
+        size_t at;
+    };
+
+    // An unlinked temporary file, gone when it is closed
+    class SpillFile {
+    private:
+        int fd;
+        off_t length;
+
+    public:
+        SpillFile() : fd(-1), length(0) {
+            const char* directory = std::getenv("TMPDIR");
+            std::string path = std::string(directory && *directory ? directory : "/tmp") +
+                               "/cpe351-sort-XXXXXX";
+            std::vector<char> name(path.begin(), path.end());
+            name.push_back('\0');
+            fd = mkstemp(name.data());
+            if (fd < 0) {
+                throw std::runtime_error("Could not create a temporary file to sort the input");
+            }
+            unlink(name.data());
+        }
+
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        ~SpillFile() { close(fd); }
+
+        off_t size() const { return length; }
+
+        void append(const Record* records, size_t count) {
+            const char* bytes = reinterpret_cast<const char*>(records);
+            size_t left = count * sizeof(Record);
+            while (left > 0) {
+                ssize_t wrote = pwrite(fd, bytes, left, length);
+                if (wrote < 0 && errno == EINTR) continue;
+                if (wrote <= 0) {
+                    throw std::runtime_error("Could not write the temporary sort file");
+                }
+                bytes += wrote;
+                left -= static_cast<size_t>(wrote);
+                length += wrote;
+            }
+        }
+
+        void read(off_t offset, Record* records, size_t count) const {
+            char* bytes = reinterpret_cast<char*>(records);
+            size_t left = count * sizeof(Record);
+            while (left > 0) {
+                ssize_t got = pread(fd, bytes, left, offset);
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0) {
+                    throw std::runtime_error("Could not read the temporary sort file");
+                }
+                bytes += got;
+                left -= static_cast<size_t>(got);
+                offset += got;
+            }
+        }
+
+        // Drop the contents once every run in them has been merged
+        void clear() {
+            if (ftruncate(fd, 0) != 0) {
+                throw std::runtime_error("Could not truncate the temporary sort file");
+            }
+            length = 0;
+        }
+    };
+
+    static constexpr size_t RUN_BUFFER_BYTES = 1 << 16;  // least read buffer per run
+    static constexpr size_t MIN_BUDGET = 2 * RUN_BUFFER_BYTES;
+
+    size_t budget;
+    std::vector<Record> sorted;  // the whole trace when it fits
+    size_t next_sorted;
+    std::unique_ptr<SpillFile> spill;
+    std::unique_ptr<SpillFile> scratch;
+    std::vector<Run> runs;
+    std::vector<RunReader> readers;
+    std::vector<int> heap;  // readers by head record, for std::push_heap
+    int spilled_runs;
+    int merge_passes;
+
+    static bool earlier(const Record& a, const Record& b) {
+        return a.arrival < b.arrival || (a.arrival == b.arrival && a.id < b.id);
+    }
+
+    // Heap order: the reader with the latest head record is "smallest"
+    bool laterHead(int a, int b) const {
+        return earlier(head(b), head(a));
+    }
+
+    const Record& head(int reader) const {
+        return readers[reader].buffer[readers[reader].at];
+    }
+
+    // False for an empty run
+    bool openRun(const SpillFile& file, const Run& run, size_t records_per_buffer,
+                 RunReader& reader) const {
+        reader.offset = run.offset;
+        reader.left = run.count;
+        reader.buffer.reserve(records_per_buffer);
+        reader.at = 0;
+        return refill(file, reader);
+    }
+
+    // False once the run is used up
+    bool refill(const SpillFile& file, RunReader& reader) const {
+        size_t count = static_cast<size_t>(std::min<long long>(
+            reader.left, static_cast<long long>(reader.buffer.capacity())));
+        if (count == 0) return false;
+        reader.buffer.resize(count);
+        file.read(reader.offset, reader.buffer.data(), count);
+        reader.offset += static_cast<off_t>(count * sizeof(Record));
+        reader.left -= static_cast<long long>(count);
+        reader.at = 0;
+        return true;
+    }
+
+    // Start merging runs [first, last) of `file` into `readers` and `heap`
+    void startMerge(const SpillFile& file, size_t first, size_t last, size_t buffers) {
+        size_t records_per_buffer = std::max<size_t>(1, budget / buffers / sizeof(Record));
+        readers.assign(last - first, RunReader());
+        heap.clear();
+        for (size_t run = first; run < last; run++) {
+            if (openRun(file, runs[run], records_per_buffer, readers[run - first])) {
+                heap.push_back(static_cast<int>(run - first));
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), [this](int a, int b) { return laterHead(a, b); });
+    }
+
+    // The next merged record; false when the merge is done
+    bool pop(const SpillFile& file, Record& record) {
+        if (heap.empty()) return false;
+        auto later = [this](int a, int b) { return laterHead(a, b); };
+        std::pop_heap(heap.begin(), heap.end(), later);
+        int reader = heap.back();
+        RunReader& source = readers[reader];
+        record = source.buffer[source.at++];
+        if (source.at < source.buffer.size() || refill(file, source)) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
+        }
+        return true;
+    }
+
+    void spillRun() {
+        std::sort(sorted.begin(), sorted.end(), earlier);
+        if (!spill) spill.reset(new SpillFile());
+        Run run = {spill->size(), static_cast<long long>(sorted.size())};
+        spill->append(sorted.data(), sorted.size());
+        runs.push_back(run);
+        sorted.clear();
+        spilled_runs++;
+    }
+
+    // Merge groups of `fan_in` runs into longer runs until one merge of
+    // them all fits the budget
+    void reduceRuns(size_t fan_in) {
+        while (runs.size() > fan_in) {
+            if (!scratch) scratch.reset(new SpillFile());
+            std::vector<Run> merged;
+            std::vector<Record> output;
+            for (size_t first = 0; first < runs.size(); first += fan_in) {
+                size_t last = std::min(runs.size(), first + fan_in);
+                size_t group = last - first;
+                startMerge(*spill, first, last, group + 1);
+                output.reserve(std::max<size_t>(1, budget / (group + 1) / sizeof(Record)));
+                Run run = {scratch->size(), 0};
+                Record record;
+                while (pop(*spill, record)) {
+                    output.push_back(record);
+                    if (output.size() == output.capacity()) {
+                        scratch->append(output.data(), output.size());
+                        output.clear();
+                    }
+                    run.count++;
+                }
+                scratch->append(output.data(), output.size());
+                output.clear();
+                merged.push_back(run);
+            }
+            readers.clear();
+            spill->clear();
+            std::swap(spill, scratch);
+            runs.swap(merged);
+            merge_passes++;
+        }
+    }
+
+public:
+    // Reads all of `input`, which should accept any order
+    ArrivalSort(TraceStream& input, size_t memory_budget)
+        : budget(std::max(memory_budget, MIN_BUDGET)), next_sorted(0), spilled_runs(0),
+          merge_passes(0) {
+        // The buffer grows by doubling up to the budget, so a short input
+        // does not take all of it
+        size_t capacity = budget / sizeof(Record);
+        Record record;
+        while (input.next(record.id, record.burst, record.arrival, record.priority,
+                          record.deadline)) {
+            if (sorted.size() == capacity) spillRun();
+            if (sorted.size() == sorted.capacity()) {
+                sorted.reserve(std::min(capacity, std::max<size_t>(1024, 2 * sorted.size())));
+            }
+            sorted.push_back(record);
+        }
+        if (!spill) {
+            std::sort(sorted.begin(), sorted.end(), earlier);
+            return;
+        }
+        if (!sorted.empty()) spillRun();
+        std::vector<Record>().swap(sorted);
+        reduceRuns(budget / RUN_BUFFER_BYTES);
+        startMerge(*spill, 0, runs.size(), runs.size());
+    }
+
+    ArrivalSort(const ArrivalSort&) = delete;
+    ArrivalSort& operator=(const ArrivalSort&) = delete;
+
+    // The next record in arrival order, as TraceStream::next
+    bool next(int& id, int& burst, int& arrival, int& priority, int& deadline) {
+        Record record;
+        if (spill) {
+            if (!pop(*spill, record)) return false;
+        } else {
+            if (next_sorted == sorted.size()) return false;
+            record = sorted[next_sorted++];
+        }
+        id = record.id;
+        burst = record.burst;
+        arrival = record.arrival;
+        priority = record.priority;
+        deadline = record.deadline;
+        return true;
+    }
+
+    int spilledRuns() const { return spilled_runs; }
+    int mergePasses() const { return merge_passes; }
+};
+
+// Process slots for streaming mode. A process holds a slot from arrival to
+// completion and freed slots are reused, so the pool only grows to the
+// largest number of processes live at once. The columns have the same
+// names as ProcessTable's so the ready-queue orderings work on both.
+struct StreamPool {
+    std::vector<int> id;
+    std::vector<int> burst_time;
+    std::vector<int> arrival_time;
+    std::vector<int> priority;
+    std::vector<int> deadline;
+    std::vector<int> remaining_time;
+    std::vector<long long> first_run;
+    std::vector<int> free_slots;
+    long long context_switches;
+    int last_dispatched;  // process id, since slots are reused
+    Timeline* timeline;
+
+    StreamPool() : context_switches(0), last_dispatched(-1), timeline(nullptr) {}
+
+    int capacity() const { return static_cast<int>(id.size()); }
+
+    int acquire(int process_id, int burst, int arrival, int process_priority,
+                int process_deadline) {
+        int row;
+        if (free_slots.empty()) {
+            row = capacity();
+            for (std::vector<int>* column : {&id, &burst_time, &arrival_time, &priority,
+                                             &deadline, &remaining_time}) {
+                column->push_back(0);
+            }
+            first_run.push_back(0);
+        } else {
+            row = free_slots.back();
+            free_slots.pop_back();
+        }
+        id[row] = process_id;
+        burst_time[row] = burst;
+        arrival_time[row] = arrival;
+        priority[row] = process_priority;
+        deadline[row] = process_deadline;
+        remaining_time[row] = burst;
+        first_run[row] = -1;
+        return row;
+    }
+
+    void release(int row) { free_slots.push_back(row); }
+
+    void dispatch(int row, long long t) {
+        if (first_run[row] < 0) first_run[row] = t;
+        if (last_dispatched >= 0 && last_dispatched != id[row]) context_switches++;
+        last_dispatched = id[row];
+    }
+};
+
+// Arrival source for streaming mode with the same interface as
+// ArrivalCursor, reading a TraceStream or an ArrivalSort. One record is
+// read ahead so the next arrival time is known; admitting a process moves
+// it into a pool slot.
+template <typename Source>
+class StreamArrivals {
+private:
+    Source& input;
+    StreamPool& pool;
+    bool pending;
+    int id, burst, arrival, priority, deadline;
+
+    void advance() { pending = input.next(id, burst, arrival, priority, deadline); }
+
+public:
+    StreamArrivals(Source& stream, StreamPool& slots)
+        : input(stream), pool(slots), pending(false), id(0), burst(0), arrival(0), priority(0),
+          deadline(0) {
+        advance();
+    }
+
+    template <typename Sink>
+    void admit(long long current_time, Sink sink) {
+        while (pending && arrival <= current_time) {
+            sink(pool.acquire(id, burst, arrival, priority, deadline));
+            advance();
+        }
+    }
+
+    bool done() const { return !pending; }
+    long long nextArrival() const { return arrival; }
+};
+
+// Event counters for --stats. The simulation loops take the counter type
+// as a template parameter: EventCounters counts, while NoCounters has empty
+// members, so a run without --stats compiles to the uncounted loop.
+struct NoCounters {
+    void event() {}
+    void queueOp() {}
+    void dispatch(int) {}
+    void complete() {}
+};
+
+struct EventCounters {
+    long long events;       // clock advances
+    long long queue_ops;    // ready-queue pushes, pops and re-keys
+    long long dispatches;   // a process gets the CPU from another (or idle)
+    long long preemptions;  // a process loses the CPU before completing
+    int running;            // row that had the CPU last, -1 after completion
+
+    EventCounters() : events(0), queue_ops(0), dispatches(0), preemptions(0), running(-1) {}
+
+    void event() { events++; }
+    void queueOp() { queue_ops++; }
+
+    void dispatch(int row) {
+        if (row == running) return;
+        dispatches++;
+        if (running >= 0) preemptions++;
+        running = row;
+    }
+
+    void complete() { running = -1; }
+};
+
+// Per-algorithm figures for --stats
+struct AlgorithmStats {
+    bool ran;
+    long long simulate_ns;
+    long long report_ns;
+    long long simulated_time;  // last completion time
+    long long bytes;           // result text formatted
+    EventCounters counters;
+
+    AlgorithmStats() : ran(false), simulate_ns(0), report_ns(0), simulated_time(0), bytes(0) {}
+};
+
+// Arg-min over parallel key and tie columns: the index of the smallest
+// (key, tie) pair, the first such index on a full tie. The vector versions
+// take two passes: a lane-wise minimum of the keys, then a compare against
+// that minimum whose match mask points at the few rows that need their tie
+// read. argMin picks the widest one the CPU supports on first use (AVX2,
+// else SSE2, which every x86-64 CPU has, else the scalar loop).
+class SelectKernel {
+public:
+    using Function = int (*)(const int*, const int*, int);
+
+    // Whether index a comes before index b
+    static bool precedes(const int* keys, const int* ties, int a, int b) {
+        if (keys[a] != keys[b]) return keys[a] < keys[b];
+        if (ties[a] != ties[b]) return ties[a] < ties[b];
+        return a < b;
+    }
+
+    static int argMin(const int* keys, const int* ties, int count) {
+        static const Function selected = choose();
+        return selected(keys, ties, count);
+    }
+
+    struct Target {
+        const char* name;
+        Function function;
+    };
+
+    // Every kernel this build and CPU can run, scalar first; argMin uses
+    // the last
+    static std::vector<Target> targets() {
+        std::vector<Target> kernels = {{"scalar", scalar}};
+#if defined(CPE351_X86) && defined(__SSE2__)
+        kernels.push_back(Target{"sse2", sse2});
+#endif
+#ifdef CPE351_X86
+        if (__builtin_cpu_supports("avx2")) kernels.push_back(Target{"avx2", avx2});
+#endif
+        return kernels;
+    }
+
+    static int scalar(const int* keys, const int* ties, int count) {
+        int best = count > 0 ? 0 : -1;
+        for (int i = 1; i < count; i++) {
+            if (precedes(keys, ties, i, best)) best = i;
+        }
+        return best;
+    }
+
+#if defined(CPE351_X86) && defined(__SSE2__)
+    static int sse2(const int* keys, const int* ties, int count) {
+        if (count < 8) return scalar(keys, ties, count);
+        // SSE2 has no 32-bit min, so select through the compare mask
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+        int i = 4;
+        for (; i + 4 <= count; i += 4) {
+            __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i less = _mm_cmplt_epi32(key, low);
+            low = _mm_or_si128(_mm_and_si128(less, key), _mm_andnot_si128(less, low));
+        }
+        alignas(16) int lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), low);
+        int minimum = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        for (int j = i; j < count; j++) minimum = std::min(minimum, keys[j]);
+
+        const __m128i target = _mm_set1_epi32(minimum);
+        int best = -1;
+        for (i = 0; i + 4 <= count; i += 4) {
+            __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(key, target)));
+            best = pickTies(ties, i, mask, best);
+        }
+        for (; i < count; i++) {
+            if (keys[i] == minimum && (best < 0 || ties[i] < ties[best])) best = i;
+        }
+        return best;
+    }
+#endif
+
+#ifdef CPE351_X86
+    __attribute__((target("avx2")))
+    static int avx2(const int* keys, const int* ties, int count) {
+        if (count < 16) return scalar(keys, ties, count);
+        // Two accumulators so consecutive mins do not wait on each other
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+        __m256i other = low;
+        int i = 8;
+        for (; i + 16 <= count; i += 16) {
+            low = _mm256_min_epi32(low, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)));
+            other = _mm256_min_epi32(other,
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i + 8)));
+        }
+        if (i + 8 <= count) {
+            low = _mm256_min_epi32(low, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)));
+            i += 8;
+        }
+        low = _mm256_min_epi32(low, other);
+        __m128i half = _mm_min_epi32(_mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1));
+        half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        int minimum = _mm_cvtsi128_si32(half);
+        for (int j = i; j < count; j++) minimum = std::min(minimum, keys[j]);
+
+        const __m256i target = _mm256_set1_epi32(minimum);
+        int best = -1;
+        for (i = 0; i + 8 <= count; i += 8) {
+            __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(key, target)));
+            best = pickTies(ties, i, mask, best);
+        }
+        for (; i < count; i++) {
+            if (keys[i] == minimum && (best < 0 || ties[i] < ties[best])) best = i;
+        }
+        return best;
+    }
+#endif
+
+private:
+#ifdef CPE351_X86
+    // Among the rows at `base` flagged in `mask`, all holding the minimum
+    // key, keep the lowest tie; a later index only wins on a strictly lower one
+    static int pickTies(const int* ties, int base, int mask, int best) {
+        while (mask != 0) {
+            int index = base + __builtin_ctz(static_cast<unsigned>(mask));
+            if (best < 0 || ties[index] < ties[best]) best = index;
+            mask &= mask - 1;
+        }
+        return best;
+    }
+#endif
+
+    static Function choose() {
+#ifdef CPE351_X86
+        if (__builtin_cpu_supports("avx2")) return avx2;
+#ifdef __SSE2__
+        return sse2;
+#endif
+#endif
+        return scalar;
+    }
+};
+
+// Ready-queue orderings (selection policies) over any table with id,
+// arrival_time, remaining_time and priority columns. A scan of the list
+// keeps the first match on a tie, i.e. the lowest id, so the id is the
+// tie-breaker. Each orders rows by (key(row), id), with a smaller key first.
+template <typename Table>
+struct ArrivalOrder {
+    const Table* table;
+    bool operator()(int a, int b) const {
+        if (table->arrival_time[a] != table->arrival_time[b]) {
+            return table->arrival_time[a] < table->arrival_time[b];
+        }
+        return table->id[a] < table->id[b];
+    }
+    int key(int row) const { return table->arrival_time[row]; }
+};
+
+template <typename Table>
+struct ShortestRemaining {
+    const Table* table;
+    bool operator()(int a, int b) const {
+        if (table->remaining_time[a] != table->remaining_time[b]) {
+            return table->remaining_time[a] < table->remaining_time[b];
+        }
+        return table->id[a] < table->id[b];
+    }
+    int key(int row) const { return table->remaining_time[row]; }
+};
+
+template <typename Table>
+struct HighestPriority {
+    const Table* table;
+    bool operator()(int a, int b) const {
+        if (table->priority[a] != table->priority[b]) {
+            return table->priority[a] > table->priority[b];
+        }
+        return table->id[a] < table->id[b];
+    }
+    // ~p reverses the order of p without overflowing
+    int key(int row) const { return ~table->priority[row]; }
+};
+
+// Earliest absolute deadline (arrival plus deadline) first; rows without a
+// deadline go after every row with one. The absolute deadline does not fit
+// an int key, so this policy is only run over the heap.
+template <typename Table>
+struct EarliestDeadline {
+    const Table* table;
+    long long due(int row) const {
+        int deadline = table->deadline[row];
+        return deadline == ProcessTable::NO_DEADLINE
+            ? LLONG_MAX : static_cast<long long>(table->arrival_time[row]) + deadline;
+    }
+    bool operator()(int a, int b) const {
+        long long due_a = due(a);
+        long long due_b = due(b);
+        if (due_a != due_b) return due_a < due_b;
+        return table->id[a] < table->id[b];
+    }
+};
+
+// FIFO ready queue with the ReadyQueue interface. Arrivals are admitted in
+// arrival order, so the queue keeps ArrivalOrder without comparing; with
+// I/O bursts a process rejoins at the back, in the order it became ready.
+template <typename Policy>
+class FifoQueue {
+private:
+    RingBuffer ring;
+
+public:
+    FifoQueue(int capacity, Policy) : ring(static_cast<size_t>(capacity)) {}
+
+    void grow(int capacity) { ring.grow(static_cast<size_t>(capacity)); }
+    bool empty() const { return ring.empty(); }
+    int top() const { return ring.front(); }
+    void push(int row) { ring.push_back(row); }
+    void pop() { ring.pop_front(); }
+    void decreaseKey(int) {}  // the running process stays at the front
+    template <typename Visit>
+    void forEach(Visit visit) const { ring.forEach(visit); }
+};
+
+// Ready queue that holds a medium-sized ready set as dense key and id
+// columns searched with SelectKernel, and any other as a ReadyQueue heap.
+// A scan reads every ready row, but in contiguous vector passes that never
+// touch the table; on its own it beats the heap's sift steps between about
+// SCAN_MIN and SCAN_LIMIT rows, while below that the heap's cached front is
+// cheaper than any search. The set moves in when it passes through the
+// middle of that range and out when it leaves it, so one hovering at a bound
+// does not move every event. The scan's front is cached too, so only a pop
+// or update rescans. On the bench workloads the heap is still as fast or
+// faster inside the engine (repeated keys send the scan to the ids), so the
+// Scheduler only uses this when asked to.
+template <typename Policy>
+class AdaptiveQueue {
+private:
+    static constexpr int SCAN_MIN = 16;
+    static constexpr int SCAN_LIMIT = 128;
+
+    Policy policy;
+    ReadyQueue<Policy> heap;
+    bool scanning;
+    int capacity;
+    std::vector<int> rows;  // the ready set while scanning
+    std::vector<int> keys;
+    std::vector<int> ties;  // ids
+    std::vector<int> slot;  // index in rows per row, -1 if absent
+    mutable int best;       // index of the front row, -1 if not known
+
+    void add(int row) {
+        int index = static_cast<int>(rows.size());
+        slot[row] = index;
+        rows.push_back(row);
+        keys.push_back(policy.key(row));
+        ties.push_back(policy.table->id[row]);
+        if (index == 0 || (best >= 0 && SelectKernel::precedes(keys.data(), ties.data(), index, best))) {
+            best = index;
+        }
+    }
+
+    CPE351_NOINLINE void toHeap() {
+        for (int row : rows) {
+            slot[row] = -1;
+            heap.push(row);
+        }
+        rows.clear();
+        keys.clear();
+        ties.clear();
+        scanning = false;
+    }
+
+    CPE351_NOINLINE void toScan() {
+        // Only sets that reach the scan range pay for the row index
+        if (static_cast<int>(slot.size()) < capacity) slot.resize(capacity, -1);
+        scanning = true;
+        heap.drain([&](int row) { add(row); });
+        best = -1;
+    }
+
+public:
+    AdaptiveQueue(int row_capacity, Policy compare)
+        : policy(compare), heap(row_capacity, compare), scanning(false), capacity(row_capacity),
+          best(-1) {
+        rows.reserve(SCAN_LIMIT);
+        keys.reserve(SCAN_LIMIT);
+        ties.reserve(SCAN_LIMIT);
+    }
+
+    void grow(int rows_needed) {
+        if (rows_needed <= capacity) return;
+        capacity = rows_needed;
+        heap.grow(capacity);
+        if (!slot.empty()) slot.resize(capacity, -1);
+    }
+
+    bool empty() const { return scanning ? rows.empty() : heap.empty(); }
+    int size() const { return scanning ? static_cast<int>(rows.size()) : heap.size(); }
+    int top() const { return scanning ? scannedTop() : heap.top(); }
+
+    // The heap paths stay small enough to inline into the engine loop; the
+    // scan paths are called out of line
+    void push(int row) {
+        if (scanning) {
+            scannedPush(row);
+            return;
+        }
+        heap.push(row);
+        if (heap.size() == 2 * SCAN_MIN) toScan();
+    }
+
+    void pop() {
+        if (scanning) {
+            scannedPop();
+            return;
+        }
+        heap.pop();
+        if (heap.size() == SCAN_LIMIT / 2) toScan();
+    }
+
+    void decreaseKey(int row) {
+        if (scanning) {
+            scannedDecreaseKey(row);
+        } else {
+            heap.decreaseKey(row);
+        }
+    }
+
+    void update(int row) {
+        if (scanning) {
+            keys[slot[row]] = policy.key(row);
+            best = -1;
+        } else {
+            heap.update(row);
+        }
+    }
+
+private:
+    CPE351_NOINLINE int scannedTop() const {
+        if (best < 0) best = SelectKernel::argMin(keys.data(), ties.data(), size());
+        return rows[best];
+    }
+
+    CPE351_NOINLINE void scannedPush(int row) {
+        if (size() == SCAN_LIMIT) {
+            toHeap();
+            heap.push(row);
+        } else {
+            add(row);
+        }
+    }
+
+    CPE351_NOINLINE void scannedPop() {
+        scannedTop();
+        int index = best;
+        int last = size() - 1;
+        slot[rows[index]] = -1;
+        if (index != last) {
+            rows[index] = rows[last];
+            keys[index] = keys[last];
+            ties[index] = ties[last];
+            slot[rows[index]] = index;
+        }
+        rows.pop_back();
+        keys.pop_back();
+        ties.pop_back();
+        best = -1;
+        if (last < SCAN_MIN) toHeap();
+    }
+
+    CPE351_NOINLINE void scannedDecreaseKey(int row) {
+        int index = slot[row];
+        keys[index] = policy.key(row);
+        if (best >= 0 && index != best &&
+            SelectKernel::precedes(keys.data(), ties.data(), index, best)) {
+            best = index;
+        }
+    }
+};
+
+// When the running process can lose the CPU: only at completion, when a
+// process arrives (and the policy prefers it), or when its quantum is used
+// up, in which case it goes to the back of the queue.
+enum class Preemption { NONE, ON_ARRIVAL, TIME_SLICE };
+
+// Discrete-event scheduling loop. The policy orders a Queue<Policy> of
+// ready rows and the preemption mode is fixed at compile time, so the
+// comparator is inlined and each mode gets its own loop. The clock only
+// moves to the next arrival or completion, so a run costs O(events * log n)
+// (O(events) with a FifoQueue) however long the simulated time span is.
+// An AdaptiveQueue in place of the default heap scans medium ready sets.
+//
+// Table is a ProcessTable or a StreamPool; Arrivals is an ArrivalCursor, an
+// IoArrivals or a StreamArrivals over it. finish(row, t) is called when a
+// row's remaining time runs out.
+// Counters is NoCounters or EventCounters.
+template <typename Policy, Preemption Mode, template <typename> class Queue = ReadyQueue>
+class Engine {
+public:
+    template <typename Table, typename Arrivals, typename Finish, typename Counters>
+    static void run(Table& table, Arrivals& arrivals, int quantum, Finish finish,
+                    Counters& counters) {
+        Queue<Policy> ready(table.capacity(), Policy{&table});
+        resume(table, arrivals, ready, 0, quantum, finish, counters,
+               [](long long, const Queue<Policy>&) {});
+    }
+
+    // Run on from `current_time` with the rows already in `ready`, e.g. a
+    // restored checkpoint. checkpoint(current_time, ready) is called at the
+    // top of every pass, where no process holds the CPU, so the clock, the
+    // ready queue, the arrivals' position and the table's result columns
+    // are the whole state.
+    template <typename Table, typename Arrivals, typename Finish, typename Counters,
+              typename Checkpoint>
+    static void resume(Table& table, Arrivals& arrivals, Queue<Policy>& ready,
+                       long long current_time, int quantum, Finish finish, Counters& counters,
+                       Checkpoint checkpoint) {
+        auto enqueue = [&](int row) {
+            ready.grow(table.capacity());
+            ready.push(row);
+            counters.queueOp();
+        };
+
+        while (!ready.empty() || !arrivals.done()) {
+            checkpoint(current_time, static_cast<const Queue<Policy>&>(ready));
+            arrivals.admit(current_time, enqueue);
+            if (ready.empty()) {
+                // Idle CPU: jump straight to the next arrival
+                current_time = arrivals.nextArrival();
+                counters.event();
+                continue;
+            }
+
+            int selected = ready.top();
+            table.dispatch(selected, current_time);
+            counters.dispatch(selected);
+
+            if constexpr (Mode == Preemption::TIME_SLICE) {
+                // Arrivals during the slice queue ahead of the process
+                ready.pop();
+                counters.queueOp();
+                int slice = std::min(quantum, table.remaining_time[selected]);
+                record(table, selected, current_time, current_time + slice);
+                current_time += slice;
+                counters.event();
+                table.remaining_time[selected] -= slice;
+                arrivals.admit(current_time, enqueue);
+                if (table.remaining_time[selected] == 0) {
+                    finish(selected, current_time);
+                    counters.complete();
+                } else {
+                    ready.push(selected);
+                    counters.queueOp();
+                }
+                continue;
+            }
+
+            // Nothing can displace the selected process before it finishes
+            // (or, when preemptive, the next process arrives), so run it up
+            // to that point in one go.
+            long long run_until = current_time + table.remaining_time[selected];
+            if constexpr (Mode == Preemption::ON_ARRIVAL) {
+                if (!arrivals.done() && arrivals.nextArrival() < run_until) {
+                    run_until = arrivals.nextArrival();
+                }
+            }
+            record(table, selected, current_time, run_until);
+            table.remaining_time[selected] -= static_cast<int>(run_until - current_time);
+            current_time = run_until;
+            counters.event();
+
+            if (table.remaining_time[selected] == 0) {
+                ready.pop();
+                finish(selected, current_time);
+                counters.complete();
+            } else {
+                // Running only ever shrinks the remaining time, so the
+                // process keeps its place at the front of the queue
+                ready.decreaseKey(selected);
+            }
+            counters.queueOp();
+        }
+    }
+
+private:
+    template <typename Table>
+    static void record(const Table& table, int row, long long start, long long end) {
+        if (table.timeline) table.timeline->record(table.id[row], start, end);
+    }
+};
+
+// What-if re-simulation of one algorithm over a trace. The first run saves
+// a checkpoint of the engine state every `interval` passes: the clock, the
+// ready queue in order, the arrival position, the remaining time and first
+// dispatch of each ready process, and the waiting time of the processes
+// done so far. A query changes one process and resumes from the last
+// checkpoint taken before both its old and its new arrival, a state the
+// change cannot have touched, so only the processes still to run from
+// there are simulated again and the rest keep their first-run results.
+// Checkpoints are thinned (every other one dropped, interval doubled)
+// whenever their saved ready rows pass SAVED_ROW_LIMIT.
+class WhatIf {
+public:
+    // New inputs for the process with 0-based id `id`
+    struct Edit {
+        int id;
+        int burst_time;
+        int arrival_time;
+        int priority;
+        int deadline;
+    };
+
+    struct Answer {
+        long double total_waiting;  // over every process
+        long long completion_time;  // of the edited process
+        long long waiting_time;
+        int changed;          // other processes whose completion time moved
+        int resimulated;      // processes simulated again
+        long long resumed_at; // clock of the checkpoint resumed from
+    };
+
+    // Algorithms 1 to 6 and 9 to 10 (FCFS, SJF, Priority, Round Robin and
+    // EDF); the trace must outlive this object
+    WhatIf(const ProcessTable& trace, int algorithm_id, int time_quantum, int checkpoint_interval)
+        : quantum(time_quantum), interval(std::max(1, checkpoint_interval)),
+          row_of(trace.size()), total_waiting(0) {
+        base.shareInputs(trace);
+        for (int row = 0; row < base.size(); row++) row_of[base.id[row]] = row;
+        switch (algorithm_id) {
+            case 1: prepare<ArrivalOrder<ProcessTable>, Preemption::NONE, FifoQueue>(); break;
+            case 2: prepare<ShortestRemaining<ProcessTable>, Preemption::NONE, ReadyQueue>(); break;
+            case 3: prepare<ShortestRemaining<ProcessTable>, Preemption::ON_ARRIVAL, ReadyQueue>(); break;
+            case 4: prepare<HighestPriority<ProcessTable>, Preemption::NONE, ReadyQueue>(); break;
+            case 5: prepare<HighestPriority<ProcessTable>, Preemption::ON_ARRIVAL, ReadyQueue>(); break;
+            case 6: prepare<ArrivalOrder<ProcessTable>, Preemption::TIME_SLICE, FifoQueue>(); break;
+            case 9: prepare<EarliestDeadline<ProcessTable>, Preemption::NONE, ReadyQueue>(); break;
+            case 10: prepare<EarliestDeadline<ProcessTable>, Preemption::ON_ARRIVAL, ReadyQueue>(); break;
+            default: throw std::runtime_error("What-if queries support fcfs, sjf, sjf-preemptive, "
+                                              "priority, priority-preemptive, rr, edf and "
+                                              "edf-preemptive");
+        }
+    }
+
+    int processCount() const { return base.size(); }
+    int checkpointCount() const { return static_cast<int>(checkpoints.size()); }
+    int checkpointInterval() const { return interval; }
+    long double baselineWaiting() const { return total_waiting; }
+
+    // The inputs of process `id` as loaded
+    Edit original(int id) const {
+        int row = row_of[id];
+        return Edit{id, base.burst_time[row], base.arrival_time[row], base.priority[row],
+                    base.deadline[row]};
+    }
+
+    Answer query(const Edit& edit) {
+        return (this->*resimulate)(edit);
+    }
+
+private:
+    static const size_t SAVED_ROW_LIMIT = size_t(1) << 22;
+
+    struct Checkpoint {
+        long long time;
+        int position;  // arrival cursor
+        long double waiting;  // total over the processes done
+        size_t first;  // saved ready rows, in queue order
+        size_t count;
+    };
+
+    int quantum;
+    int interval;
+    ProcessTable base;         // first-run results
+    std::vector<int> row_of;   // base row per id
+    long double total_waiting;
+    std::vector<Checkpoint> checkpoints;
+    std::vector<int> saved_rows;
+    std::vector<int> saved_remaining;
+    std::vector<long long> saved_first_run;
+    ProcessTable suffix;       // scratch table of the latest query
+    Answer (WhatIf::*resimulate)(const Edit&);
+
+    void thin() {
+        size_t kept = 0;
+        size_t rows = 0;
+        for (size_t i = 0; i < checkpoints.size(); i += 2) {
+            Checkpoint checkpoint = checkpoints[i];
+            for (size_t j = 0; j < checkpoint.count; j++) {
+                saved_rows[rows + j] = saved_rows[checkpoint.first + j];
+                saved_remaining[rows + j] = saved_remaining[checkpoint.first + j];
+                saved_first_run[rows + j] = saved_first_run[checkpoint.first + j];
+            }
+            checkpoint.first = rows;
+            rows += checkpoint.count;
+            checkpoints[kept++] = checkpoint;
+        }
+        checkpoints.resize(kept);
+        saved_rows.resize(rows);
+        saved_remaining.resize(rows);
+        saved_first_run.resize(rows);
+        interval *= 2;
+    }
+
+    template <typename Policy, Preemption Mode, template <typename> class Queue>
+    void prepare() {
+        ArrivalCursor arrivals(base);
+        Queue<Policy> ready(base.capacity(), Policy{&base});
+        NoCounters counters;
+        long long passes = 0;
+        auto finish = [&](int row, long long current_time) {
+            base.completion_time[row] = current_time;
+            base.waiting_time[row] = current_time - base.arrival_time[row] - base.burst_time[row];
+            base.remaining_time[row] = 0;
+            total_waiting += base.waiting_time[row];
+        };
+        auto checkpoint = [&](long long current_time, const Queue<Policy>& queue) {
+            if (passes++ % interval != 0) return;
+            Checkpoint saved{current_time, arrivals.position(), total_waiting,
+                             saved_rows.size(), 0};
+            queue.forEach([&](int row) {
+                saved_rows.push_back(row);
+                saved_remaining.push_back(base.remaining_time[row]);
+                saved_first_run.push_back(base.first_run[row]);
+            });
+            saved.count = saved_rows.size() - saved.first;
+            checkpoints.push_back(saved);
+            if (saved_rows.size() > SAVED_ROW_LIMIT && checkpoints.size() > 1) {
+                thin();
+                passes = 1;  // the pass just saved is the new phase
+            }
+        };
+        Engine<Policy, Mode, Queue>::resume(base, arrivals, ready, 0, quantum, finish, counters,
+                                            checkpoint);
+        resimulate = &WhatIf::resume<Policy, Mode, Queue>;
+    }
+
+    template <typename Policy, Preemption Mode, template <typename> class Queue>
+    Answer resume(const Edit& edit) {
+        int edited_row = row_of[edit.id];
+        long long changed_from = std::min(base.arrival_time[edited_row], edit.arrival_time);
+        // The first checkpoint is the empty start, which any change leaves alone
+        auto later = std::partition_point(checkpoints.begin() + 1, checkpoints.end(),
+                                          [&](const Checkpoint& c) { return c.time < changed_from; });
+        const Checkpoint& from = *(later - 1);
+
+        // The suffix table: the saved ready rows, then the rows not yet
+        // admitted, with the edited one moved to its new place in arrival
+        // (then id) order
+        int admitted = static_cast<int>(from.count);
+        int rows = admitted + base.size() - from.position;
+        ProcessTable::InputColumns columns = suffix.allocate(rows);
+        int out = 0;
+        auto copy = [&](int row) {
+            columns.id[out] = base.id[row];
+            columns.burst_time[out] = base.burst_time[row];
+            columns.arrival_time[out] = base.arrival_time[row];
+            columns.priority[out] = base.priority[row];
+            columns.deadline[out] = base.deadline[row];
+            out++;
+        };
+        auto insert = [&]() {
+            columns.id[out] = edit.id;
+            columns.burst_time[out] = edit.burst_time;
+            columns.arrival_time[out] = edit.arrival_time;
+            columns.priority[out] = edit.priority;
+            columns.deadline[out] = edit.deadline;
+            out++;
+        };
+        for (size_t i = 0; i < from.count; i++) copy(saved_rows[from.first + i]);
+        bool placed = false;
+        for (int row = from.position; row < base.size(); row++) {
+            if (row == edited_row) continue;
+            if (!placed && (base.arrival_time[row] > edit.arrival_time ||
+                            (base.arrival_time[row] == edit.arrival_time && base.id[row] > edit.id))) {
+                insert();
+                placed = true;
+            }
+            copy(row);
+        }
+        if (!placed) insert();
+        suffix.reset();
+        for (int row = 0; row < admitted; row++) {
+            suffix.remaining_time[row] = saved_remaining[from.first + row];
+            suffix.first_run[row] = saved_first_run[from.first + row];
+        }
+
+        Answer answer{from.waiting, 0, 0, 0, rows, from.time};
+        auto finish = [&](int row, long long current_time) {
+            long long waiting_time = current_time - suffix.arrival_time[row] - suffix.burst_time[row];
+            answer.total_waiting += waiting_time;
+            suffix.remaining_time[row] = 0;
+            if (suffix.id[row] == edit.id) {
+                answer.completion_time = current_time;
+                answer.waiting_time = waiting_time;
+            } else if (base.completion_time[row_of[suffix.id[row]]] != current_time) {
+                answer.changed++;
+            }
+        };
+        ArrivalCursor arrivals(suffix, admitted);
+        Queue<Policy> ready(suffix.capacity(), Policy{&suffix});
+        for (int row = 0; row < admitted; row++) ready.push(row);
+        NoCounters counters;
+        Engine<Policy, Mode, Queue>::resume(suffix, arrivals, ready, from.time, quantum, finish,
+                                            counters, [](long long, const Queue<Policy>&) {});
+        return answer;
+    }
+};
+
+class Scheduler {
+private:
+    static constexpr int ALGORITHM_COUNT = 12;
+    static constexpr int MAX_SWEEP_POINTS = 10000;  // quanta one sweepQuantum may run
+
+    ProcessTable processes;
+    int quantum;
+    int process_count;
+    bool rr_sweep;  // reproduce the original id-order sweep for Round Robin
+    int jobs;       // worker threads for runAllAlgorithms
+    bool echo;      // copy result lines to the console
+    int mlfq_levels;
+    long long mlfq_boost;  // priority boost period, 0 for none
+    bool mlfq_demote;
+    long long cfs_latency;  // target period in which every runnable process runs
+    uint64_t lottery_seed;
+    int io_devices;  // I/O devices for traces with I/O bursts
+    DevicePool::Discipline io_discipline;
+    bool adaptive_queue;    // SJF and Priority over an AdaptiveQueue instead of a heap
+    size_t sort_memory;     // budget to sort streamed input in, 0 if it is arrival-ordered
+    bool metrics;       // follow each result line with a summary line
+    bool summary_only;  // write only the summary lines
+    std::unique_ptr<Timeline> timeline;
+    bool collect_stats;
+    long long load_ns;
+    std::vector<AlgorithmStats> stats;  // by algorithm id - 1
+    std::vector<long double> waiting_totals;  // by algorithm id - 1, from the last report
+
+    static long long elapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct ById {
+        const ProcessTable* table;
+        bool operator()(int a, int b) const {
+            return table->id[a] < table->id[b];
+        }
+    };
+
+    static void complete(ProcessTable& table, int row, long long current_time) {
+        table.completion_time[row] = current_time;
+        table.waiting_time[row] = current_time -
+                                  table.arrival_time[row] -
+                                  table.burst_time[row];
+        if (!table.blocked_time.empty()) table.waiting_time[row] -= table.blocked_time[row];
+        table.remaining_time[row] = 0;
+    }
+
+    // Tell the timeline, if any, that `row` ran from `start` to `end`
+    static void ran(const ProcessTable& table, int row, long long start, long long end) {
+        if (table.timeline) table.timeline->record(table.id[row], start, end);
+    }
+
+    // Run body(arrivals) with the table's arrival source: an IoArrivals
+    // over the configured devices when the trace has I/O bursts, otherwise
+    // an ArrivalCursor
+    template <typename Body>
+    void withArrivals(ProcessTable& table, Body body) const {
+        if (!table.cycles) {
+            ArrivalCursor arrivals(table);
+            body(arrivals);
+            return;
+        }
+        IoArrivals arrivals(table, io_devices, io_discipline);
+        body(arrivals);
+        arrivals.record();
+    }
+
+    // Run one engine instantiation over the whole table
+    template <typename Policy, Preemption Mode, template <typename> class Queue = ReadyQueue,
+              typename Arrivals, typename Counters>
+    static void simulate(ProcessTable& table, Arrivals& arrivals, Counters& counters,
+                         int quantum = INT_MAX) {
+        Engine<Policy, Mode, Queue>::run(table, arrivals, quantum, [&](int row, long long t) {
+            if (arrivals.release(row, t)) complete(table, row, t);
+        }, counters);
+    }
+
+    // The table is already in arrival order, so FCFS needs no ready queue;
+    // this matches Engine<ArrivalOrder, Preemption::NONE, FifoQueue> at a
+    // fraction of the cost. With I/O bursts a process comes back in the
+    // order its I/O finishes, so that case does run the engine.
+    template <typename Arrivals, typename Counters>
+    static void calculateFCFS(ProcessTable& table, Arrivals& arrivals, Counters& counters) {
+        if constexpr (!std::is_same<Arrivals, ArrivalCursor>::value) {
+            simulate<ArrivalOrder<ProcessTable>, Preemption::NONE, FifoQueue>(table, arrivals,
+                                                                              counters);
+            return;
+        }
+        long long current_time = 0;
+
+        for (int row = 0; row < table.size(); row++) {
+            if (current_time < table.arrival_time[row]) {
+                current_time = table.arrival_time[row];
+                counters.event();
+            }
+
+            table.dispatch(row, current_time);
+            counters.dispatch(row);
+            ran(table, row, current_time, current_time + table.burst_time[row]);
+            current_time += table.burst_time[row];
+            counters.event();
+            complete(table, row, current_time);
+            counters.complete();
+        }
+    }
+
+    // Run a selecting policy over the configured ready queue
+    template <typename Policy, Preemption Mode, typename Arrivals, typename Counters>
+    void simulateSelecting(ProcessTable& table, Arrivals& arrivals, Counters& counters) const {
+        if (adaptive_queue) {
+            simulate<Policy, Mode, AdaptiveQueue>(table, arrivals, counters);
+        } else {
+            simulate<Policy, Mode>(table, arrivals, counters);
+        }
+    }
+
+    template <typename Arrivals, typename Counters>
+    void calculateSJFNonPreemptive(ProcessTable& table, Arrivals& arrivals,
+                                   Counters& counters) const {
+        simulateSelecting<ShortestRemaining<ProcessTable>, Preemption::NONE>(table, arrivals,
+                                                                             counters);
+    }
+
+    template <typename Arrivals, typename Counters>
+    void calculateSJFPreemptive(ProcessTable& table, Arrivals& arrivals,
+                                Counters& counters) const {
+        simulateSelecting<ShortestRemaining<ProcessTable>, Preemption::ON_ARRIVAL>(
+            table, arrivals, counters);
+    }
+
+    template <typename Arrivals, typename Counters>
+    void calculatePriorityNonPreemptive(ProcessTable& table, Arrivals& arrivals,
+                                        Counters& counters) const {
+        simulateSelecting<HighestPriority<ProcessTable>, Preemption::NONE>(table, arrivals,
+                                                                           counters);
+    }
+
+    template <typename Arrivals, typename Counters>
+    void calculatePriorityPreemptive(ProcessTable& table, Arrivals& arrivals,
+                                     Counters& counters) const {
+        simulateSelecting<HighestPriority<ProcessTable>, Preemption::ON_ARRIVAL>(
+            table, arrivals, counters);
+    }
+
+    template <typename Arrivals, typename Counters>
+    static void calculateEDF(ProcessTable& table, Arrivals& arrivals, Counters& counters) {
+        simulate<EarliestDeadline<ProcessTable>, Preemption::NONE>(table, arrivals, counters);
+    }
+
+    template <typename Arrivals, typename Counters>
+    static void calculateEDFPreemptive(ProcessTable& table, Arrivals& arrivals,
+                                       Counters& counters) {
+        simulate<EarliestDeadline<ProcessTable>, Preemption::ON_ARRIVAL>(table, arrivals,
+                                                                         counters);
+    }
+
+    // The id-order sweep only runs without I/O bursts; loadProcesses
+    // turns down a trace with them when it is asked for
+    template <typename Arrivals, typename Counters>
+    void calculateRoundRobin(ProcessTable& table, Arrivals& arrivals, int time_quantum,
+                             Counters& counters) const {
+        if constexpr (std::is_same<Arrivals, ArrivalCursor>::value) {
+            if (rr_sweep) {
+                calculateRoundRobinSweep(table, arrivals, time_quantum, counters);
+                return;
+            }
+        }
+        simulate<ArrivalOrder<ProcessTable>, Preemption::TIME_SLICE, FifoQueue>(
+            table, arrivals, counters, time_quantum);
+    }
+
+    // Compatibility mode: each pass serves the arrived processes in id
+    // order, and the clock advances as it goes, so a process can join the
+    // pass it arrives in if its id is still ahead of the sweep. The arrived
+    // set is kept ordered by id so a pass only visits runnable processes
+    // instead of the whole table.
+    template <typename Counters>
+    static void calculateRoundRobinSweep(ProcessTable& table, ArrivalCursor& arrivals,
+                                         int time_quantum, Counters& counters) {
+        std::set<int, ById> arrived(ById{&table});
+        long long current_time = 0;
+        int completed = 0;
+
+        auto admit = [&](int row) {
+            arrived.insert(row);
+            counters.queueOp();
+        };
+
+        while (completed != table.size()) {
+            arrivals.admit(current_time, admit);
+            if (arrived.empty()) {
+                current_time = arrivals.nextArrival();
+                counters.event();
+                continue;
+            }
+
+            auto it = arrived.begin();
+            while (it != arrived.end()) {
+                int current = *it;
+                table.dispatch(current, current_time);
+                counters.dispatch(current);
+                ran(table, current, current_time,
+                    current_time + std::min(time_quantum, table.remaining_time[current]));
+
+                if (table.remaining_time[current] > time_quantum) {
+                    current_time += time_quantum;
+                    table.remaining_time[current] -= time_quantum;
+                } else {
+                    current_time += table.remaining_time[current];
+                    complete(table, current, current_time);
+                    counters.complete();
+                    completed++;
+                }
+                counters.event();
+
+                arrivals.admit(current_time, admit);
+                if (table.remaining_time[current] == 0) {
+                    it = arrived.erase(it);
+                    counters.queueOp();
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    // Multilevel feedback queue, algorithm 7. Level 0 is the highest; level
+    // k gets a quantum of quantum * 2^k. Each level is an intrusive FIFO
+    // threaded through `next`, and bit k of `occupied` is set while level k
+    // has work, so the level to serve is a find-first-set. A process that
+    // uses up its quantum moves down a level (when demotion is on); a new
+    // arrival preempts anything below level 0. Every `mlfq_boost` time
+    // units all levels are spliced onto level 0; rows learn their new
+    // level lazily through the boost epoch, so a boost costs O(levels).
+    template <typename Arrivals, typename Counters>
+    void calculateMLFQ(ProcessTable& table, Arrivals& arrivals, Counters& counters) const {
+        int rows = table.size();
+        std::vector<int> next(rows, -1);
+        std::vector<int> level(rows, 0);
+        std::vector<int> epoch(rows, 0);
+        std::vector<long long> used(rows, 0);  // time spent at the current level
+        std::vector<int> head(mlfq_levels, -1), tail(mlfq_levels, -1);
+        uint64_t occupied = 0;
+        int boost_epoch = 0;
+
+        auto pushBack = [&](int k, int row) {
+            counters.queueOp();
+            next[row] = -1;
+            if (tail[k] < 0) head[k] = row; else next[tail[k]] = row;
+            tail[k] = row;
+            occupied |= 1ULL << k;
+        };
+        auto pushFront = [&](int k, int row) {
+            counters.queueOp();
+            next[row] = head[k];
+            head[k] = row;
+            if (tail[k] < 0) tail[k] = row;
+            occupied |= 1ULL << k;
+        };
+        auto popFront = [&](int k) {
+            counters.queueOp();
+            int row = head[k];
+            head[k] = next[row];
+            if (head[k] < 0) {
+                tail[k] = -1;
+                occupied &= ~(1ULL << k);
+            }
+            return row;
+        };
+        auto boost = [&]() {
+            for (int k = 1; k < mlfq_levels; k++) {
+                if (head[k] < 0) continue;
+                if (tail[0] < 0) head[0] = head[k]; else next[tail[0]] = head[k];
+                tail[0] = tail[k];
+                head[k] = tail[k] = -1;
+            }
+            occupied = head[0] >= 0 ? 1 : 0;
+            boost_epoch++;
+        };
+        auto levelQuantum = [&](int k) {
+            return std::min(static_cast<long long>(quantum) << std::min(k, 32),
+                            static_cast<long long>(INT_MAX));
+        };
+
+        auto admit = [&](int row) {
+            level[row] = 0;
+            used[row] = 0;
+            epoch[row] = boost_epoch;
+            pushBack(0, row);
+        };
+
+        long long current_time = 0;
+        long long next_boost = mlfq_boost > 0 ? mlfq_boost : LLONG_MAX;
+        int completed = 0;
+
+        while (completed != rows) {
+            arrivals.admit(current_time, admit);
+            if (current_time >= next_boost) {
+                boost();
+                next_boost = (current_time / mlfq_boost + 1) * mlfq_boost;
+            }
+            if (occupied == 0) {
+                current_time = arrivals.nextArrival();
+                counters.event();
+                continue;
+            }
+
+            int k = __builtin_ctzll(occupied);
+            int current = popFront(k);
+            if (epoch[current] != boost_epoch) {
+                // Boosted while queued
+                level[current] = 0;
+                used[current] = 0;
+                epoch[current] = boost_epoch;
+            }
+            table.dispatch(current, current_time);
+            counters.dispatch(current);
+
+            long long allotment = levelQuantum(k);
+            long long run_until = current_time +
+                std::min(allotment - used[current],
+                         static_cast<long long>(table.remaining_time[current]));
+            if (k > 0 && !arrivals.done() && arrivals.nextArrival() < run_until) {
+                run_until = arrivals.nextArrival();
+            }
+            run_until = std::min(run_until, next_boost);
+
+            long long slice = run_until - current_time;
+            ran(table, current, current_time, run_until);
+            table.remaining_time[current] -= static_cast<int>(slice);
+            used[current] += slice;
+            current_time = run_until;
+            counters.event();
+            arrivals.admit(current_time, admit);
+
+            if (table.remaining_time[current] == 0) {
+                // Back from I/O it starts again at level 0, through admit
+                if (arrivals.release(current, current_time)) {
+                    complete(table, current, current_time);
+                    completed++;
+                }
+                counters.complete();
+            } else if (used[current] == allotment) {
+                if (mlfq_demote && k + 1 < mlfq_levels) level[current] = k + 1;
+                used[current] = 0;
+                pushBack(level[current], current);
+            } else {
+                // Preempted by an arrival or a boost; resume first in its level
+                pushFront(k, current);
+            }
+        }
+    }
+
+    // Load weight for a priority, from the Linux nice-to-weight table. A
+    // higher priority maps to a lower nice value: priority p is nice -p,
+    // clamped to -20..19, so priority 0 has the nice-0 weight of 1024.
+    static long long cfsWeight(int priority) {
+        static const int weights[40] = {
+            88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+             9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+             1024,   820,   655,   526,   423,   335,   272,   215,   172,   137,
+              110,    87,    70,    56,    45,    36,    29,    23,    18,    15
+        };
+        int nice = -std::max(-19, std::min(20, priority));
+        return weights[nice + 20];
+    }
+
+    // Completely fair scheduling, algorithm 8. Every runnable process has a
+    // virtual runtime that advances by real runtime scaled by 1024/weight
+    // (kept in 2^20 fixed point), and the runnable set is a red-black tree
+    // (std::set) ordered by virtual runtime, then id, so the next process is
+    // the leftmost node and re-insertion is O(log n). A process runs for its
+    // weighted share of `cfs_latency` (at least the minimum granularity) and
+    // is preempted early when an arrival is behind it by more than that
+    // granularity. Arrivals start at the tree's minimum virtual runtime.
+    template <typename Arrivals, typename Counters>
+    void calculateCFS(ProcessTable& table, Arrivals& arrivals, Counters& counters) const {
+        typedef std::tuple<long long, int, int> Node;  // vruntime, id, row
+        const long long scale = 1LL << 20;
+        const long long granularity = std::max(1LL, cfs_latency / 8);
+        const long long wakeup_granularity = granularity * scale / 1024;
+
+        std::set<Node> tree;
+        std::vector<long long> vruntime(table.size(), 0);
+        long long min_vruntime = 0;
+        long long total_weight = 0;
+
+        auto admit = [&](int row) {
+            vruntime[row] = min_vruntime;
+            tree.insert(Node(vruntime[row], table.id[row], row));
+            counters.queueOp();
+            total_weight += cfsWeight(table.priority[row]);
+        };
+
+        long long current_time = 0;
+        long long slice_end = 0;
+        int current = -1;
+        int completed = 0;
+
+        while (completed != table.size()) {
+            arrivals.admit(current_time, admit);
+
+            if (current < 0) {
+                if (tree.empty()) {
+                    current_time = arrivals.nextArrival();
+                    counters.event();
+                    continue;
+                }
+                current = std::get<2>(*tree.begin());
+                tree.erase(tree.begin());
+                counters.queueOp();
+                table.dispatch(current, current_time);
+                counters.dispatch(current);
+                long long share = cfs_latency * cfsWeight(table.priority[current]) / total_weight;
+                slice_end = current_time + std::max(granularity, share);
+            }
+
+            long long run_until = std::min(slice_end,
+                current_time + table.remaining_time[current]);
+            if (!arrivals.done() && arrivals.nextArrival() < run_until) {
+                run_until = arrivals.nextArrival();
+            }
+
+            long long slice = run_until - current_time;
+            long long weight = cfsWeight(table.priority[current]);
+            ran(table, current, current_time, run_until);
+            table.remaining_time[current] -= static_cast<int>(slice);
+            vruntime[current] += slice * scale / weight;
+            current_time = run_until;
+            counters.event();
+
+            long long leftmost = tree.empty() ? vruntime[current]
+                                              : std::get<0>(*tree.begin());
+            min_vruntime = std::max(min_vruntime, std::min(vruntime[current], leftmost));
+
+            if (table.remaining_time[current] == 0) {
+                if (arrivals.release(current, current_time)) {
+                    complete(table, current, current_time);
+                    completed++;
+                }
+                counters.complete();
+                total_weight -= weight;
+                current = -1;
+                continue;
+            }
+
+            arrivals.admit(current_time, admit);
+            if (current_time >= slice_end ||
+                (!tree.empty() && vruntime[current] - std::get<0>(*tree.begin()) > wakeup_granularity)) {
+                tree.insert(Node(vruntime[current], table.id[current], current));
+                counters.queueOp();
+                current = -1;
+            }
+        }
+    }
+
+    // A uniform draw in [0, bound) for bound > 0: the high half of the
+    // 128-bit product of a 64-bit draw and `bound`, redrawing the few
+    // values that would favour some results (Lemire's method). The product
+    // is built from 32-bit halves, so no 128-bit integer type is needed.
+    static uint64_t drawBelow(std::mt19937_64& random, uint64_t bound) {
+        while (true) {
+            uint64_t draw = random();
+            uint64_t draw_low = draw & 0xffffffffu, draw_high = draw >> 32;
+            uint64_t bound_low = bound & 0xffffffffu, bound_high = bound >> 32;
+            uint64_t low_low = draw_low * bound_low;
+            uint64_t high_low = draw_high * bound_low;
+            uint64_t low_high = draw_low * bound_high;
+            uint64_t middle = (low_low >> 32) + (high_low & 0xffffffffu) + low_high;
+            uint64_t high = draw_high * bound_high + (high_low >> 32) + (middle >> 32);
+            uint64_t low = (middle << 32) | (low_low & 0xffffffffu);
+            if (low >= bound || low >= (0 - bound) % bound) return high;
+        }
+    }
+
+    // Lottery scheduling, algorithm 11. Every ready process holds its
+    // tickets (ShareAccuracy::tickets) in a Fenwick tree by row. Each
+    // quantum one ticket is drawn and its holder runs, so a draw and a
+    // ticket update are O(log n). Every run draws from lottery_seed, so
+    // results repeat; drawBelow maps the 64-bit draws onto the tickets the
+    // same way on every platform.
+    template <typename Arrivals, typename Counters>
+    void calculateLottery(ProcessTable& table, Arrivals& arrivals, Counters& counters) const {
+        FenwickTree held(table.size());
+        std::mt19937_64 random(lottery_seed);
+        auto admit = [&](int row) {
+            held.add(row, ShareAccuracy::tickets(table.priority[row]));
+            counters.queueOp();
+        };
+
+        long long current_time = 0;
+        int completed = 0;
+        while (completed != table.size()) {
+            arrivals.admit(current_time, admit);
+            if (held.total() == 0) {
+                current_time = arrivals.nextArrival();
+                counters.event();
+                continue;
+            }
+
+            long long ticket = static_cast<long long>(
+                drawBelow(random, static_cast<uint64_t>(held.total())));
+            int current = held.find(ticket);
+            table.dispatch(current, current_time);
+            counters.dispatch(current);
+            int slice = std::min(quantum, table.remaining_time[current]);
+            ran(table, current, current_time, current_time + slice);
+            current_time += slice;
+            table.remaining_time[current] -= slice;
+            counters.event();
+
+            if (table.remaining_time[current] == 0) {
+                if (arrivals.release(current, current_time)) {
+                    complete(table, current, current_time);
+                    completed++;
+                }
+                counters.complete();
+                held.add(current, -ShareAccuracy::tickets(table.priority[current]));
+                counters.queueOp();
+            }
+        }
+    }
+
+    // Orders stride rows by pass, then id
+    struct ByPass {
+        const std::vector<long long>* pass;
+        const ProcessTable* table;
+        bool operator()(int a, int b) const {
+            if ((*pass)[a] != (*pass)[b]) return (*pass)[a] < (*pass)[b];
+            return table->id[a] < table->id[b];
+        }
+    };
+
+    // Stride scheduling, algorithm 12, the deterministic counterpart of
+    // lottery. A process's stride is STRIDE1 / tickets and its pass moves
+    // on by its stride for every quantum it runs; the lowest pass runs
+    // next, from an indexed heap. An arrival starts at the pass of the
+    // process dispatched last, the lowest in the system at the time, so
+    // it neither starves the others nor is starved by them. No ready pass
+    // is more than STRIDE1 above the lowest, so once the lowest passes
+    // PASS_REBASE every pass is moved down by it, which keeps their order
+    // and keeps them far from overflowing.
+    template <typename Arrivals, typename Counters>
+    void calculateStride(ProcessTable& table, Arrivals& arrivals, Counters& counters) const {
+        const long long STRIDE1 = 1LL << 31;  // at least INT_MAX, so every stride is >= 1
+        const long long PASS_REBASE = 1LL << 62;
+        std::vector<long long> pass(table.size(), 0);
+        ReadyQueue<ByPass> ready(table.size(), ByPass{&pass, &table});
+        long long global_pass = 0;
+        auto admit = [&](int row) {
+            pass[row] = global_pass;
+            ready.push(row);
+            counters.queueOp();
+        };
+
+        long long current_time = 0;
+        while (!ready.empty() || !arrivals.done()) {
+            arrivals.admit(current_time, admit);
+            if (ready.empty()) {
+                current_time = arrivals.nextArrival();
+                counters.event();
+                continue;
+            }
+
+            int current = ready.top();
+            ready.pop();
+            counters.queueOp();
+            global_pass = pass[current];
+            if (global_pass >= PASS_REBASE) {
+                ready.forEach([&](int row) { pass[row] -= global_pass; });
+                pass[current] = 0;
+                global_pass = 0;
+            }
+            table.dispatch(current, current_time);
+            counters.dispatch(current);
+            int slice = std::min(quantum, table.remaining_time[current]);
+            ran(table, current, current_time, current_time + slice);
+            current_time += slice;
+            table.remaining_time[current] -= slice;
+            counters.event();
+
+            // Arrivals during the slice are admitted at the old global pass
+            arrivals.admit(current_time, admit);
+            if (table.remaining_time[current] == 0) {
+                if (arrivals.release(current, current_time)) complete(table, current, current_time);
+                counters.complete();
+            } else {
+                pass[current] += STRIDE1 / ShareAccuracy::tickets(table.priority[current]);
+                ready.push(current);
+                counters.queueOp();
+            }
+        }
+    }
+
+    template <typename Counters>
+    void runAlgorithm(int algorithm_id, ProcessTable& table, Counters& counters) const {
+        withArrivals(table, [&](auto& arrivals) {
+            switch (algorithm_id) {
+                case 1: calculateFCFS(table, arrivals, counters); break;
+                case 2: calculateSJFNonPreemptive(table, arrivals, counters); break;
+                case 3: calculateSJFPreemptive(table, arrivals, counters); break;
+                case 4: calculatePriorityNonPreemptive(table, arrivals, counters); break;
+                case 5: calculatePriorityPreemptive(table, arrivals, counters); break;
+                case 6: calculateRoundRobin(table, arrivals, quantum, counters); break;
+                case 7: calculateMLFQ(table, arrivals, counters); break;
+                case 8: calculateCFS(table, arrivals, counters); break;
+                case 9: calculateEDF(table, arrivals, counters); break;
+                case 10: calculateEDFPreemptive(table, arrivals, counters); break;
+                case 11: calculateLottery(table, arrivals, counters); break;
+                case 12: calculateStride(table, arrivals, counters); break;
+            }
+        });
+    }
+
+public:
+    Scheduler(int q = 2, bool sweep = false, int job_count = 1, bool echo_results = true)
+        : quantum(q), process_count(0), rr_sweep(sweep), jobs(job_count),
+          echo(echo_results), mlfq_levels(3), mlfq_boost(100), mlfq_demote(true),
+          cfs_latency(24), lottery_seed(1), io_devices(1), io_discipline(DevicePool::FCFS),
+          adaptive_queue(false), sort_memory(0), metrics(false), summary_only(false), collect_stats(false),
+          load_ns(0), stats(ALGORITHM_COUNT), waiting_totals(ALGORITHM_COUNT, 0) {}
+
+    void configureMLFQ(int levels, long long boost_period, bool demote) {
+        mlfq_levels = levels;
+        mlfq_boost = boost_period;
+        mlfq_demote = demote;
+    }
+
+    void configureCFS(long long latency) {
+        cfs_latency = latency;
+    }
+
+    // Seed of the ticket draws; every lottery run starts from it
+    void configureLottery(uint64_t seed) {
+        lottery_seed = seed;
+    }
+
+    // Serve the I/O bursts of a trace that has them on `count` devices
+    // sharing one queue in `discipline` order
+    void configureDevices(int count, DevicePool::Discipline discipline) {
+        io_devices = count;
+        io_discipline = discipline;
+    }
+
+    // Give SJF and Priority an AdaptiveQueue, which searches ready sets of
+    // a few dozen rows with SelectKernel, instead of the indexed heap
+    void configureReadyQueue(bool adaptive) {
+        adaptive_queue = adaptive;
+    }
+
+    // Sort streamed input by arrival before scheduling it, in at most
+    // `memory_budget` bytes (see ArrivalSort); 0 keeps the input in order
+    void configureStreamSort(size_t memory_budget) {
+        sort_memory = memory_budget;
+    }
+
+    // With `with_metrics` each result line is followed by a `#` summary
+    // line; with `summary` only the summary lines are written.
+    void configureReport(bool with_metrics, bool summary) {
+        metrics = with_metrics;
+        summary_only = summary;
+    }
+
+    // Time the load, each algorithm and each report, and count simulation
+    // events; see writeStats
+    void configureStats(bool enabled) {
+        collect_stats = enabled;
+    }
+
+    // Record every run slice of the following runs to `file`
+    void recordTimeline(const std::string& file, Timeline::Format format) {
+        timeline.reset(new Timeline(file, format));
+    }
+
+    // Load a text or binary trace; the format is detected from the header
+    void loadProcesses(const std::string& input_file) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::shared_ptr<const MappedFile> file = std::make_shared<MappedFile>(input_file);
+        if (BinaryTrace::matches(*file)) {
+            BinaryTrace::load(std::move(file), processes);
+        } else {
+            TraceParser::load(*file, processes, jobs);
+        }
+        if (processes.cycles && rr_sweep) {
+            throw std::runtime_error("--rr-sweep does not support I/O bursts");
+        }
+        process_count = processes.size();
+        if (collect_stats) load_ns = elapsedNs(start);
+    }
+
+    void saveBinaryTrace(const std::string& output_file) const {
+        BinaryTrace::write(processes, output_file);
+    }
+
+    void generateProcesses(const WorkloadSpec& spec, int count) {
+        WorkloadGenerator(spec).generate(count, processes);
+        process_count = processes.size();
+    }
+
+    int processCount() const { return process_count; }
+
+    // Total waiting time of the last reported run of an algorithm
+    long double totalWaiting(int algorithm_id) const {
+        return waiting_totals[algorithm_id - 1];
+    }
+
+    // Run one algorithm on the loaded table and return the wall time it took
+    // in nanoseconds. `simulated_time` gets the last completion time.
+    long long timeAlgorithm(int algorithm_id, long long& simulated_time) {
+        processes.reset();
+        NoCounters counters;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        runAlgorithm(algorithm_id, processes, counters);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        simulated_time = 0;
+        for (int row = 0; row < process_count; row++) {
+            simulated_time = std::max(simulated_time, processes.completion_time[row]);
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+
+    static const char* algorithmName(int algorithm_id) {
+        static const char* const names[] = {
+            "fcfs", "sjf", "sjf-preemptive", "priority", "priority-preemptive", "rr",
+            "mlfq", "cfs", "edf", "edf-preemptive", "lottery", "stride"
+        };
+        return names[algorithm_id - 1];
+    }
+
+    static int algorithmCount() { return ALGORITHM_COUNT; }
+
+    // The number of quanta sweepQuantum runs for first..last by step
+    static long long sweepPoints(int first, int last, int step) {
+        return (static_cast<long long>(last) - first) / step + 1;
+    }
+
+    static int maxSweepPoints() { return MAX_SWEEP_POINTS; }
+
+    // Run one algorithm and write its result line
+    void runOneAlgorithm(int algorithm_id, const std::string& output_file) {
+        ResultWriter writer(output_file, echo);
+        OutputBuffer output(&writer);
+        std::vector<long long> by_id(summary_only ? 0 : process_count);
+        processes.reset();
+        processes.timeline = timeline.get();
+        if (timeline) timeline->begin(algorithm_id, algorithmName(algorithm_id));
+        execute(algorithm_id, processes);
+        report(algorithm_id, processes, 1, by_id, output);
+        output.flush();
+        finishTimeline();
+    }
+
+    // The id of the algorithm called `name`, or 0 if there is none
+    static int algorithmId(const std::string& name) {
+        for (int algorithm_id = 1; algorithm_id <= ALGORITHM_COUNT; algorithm_id++) {
+            if (name == algorithmName(algorithm_id)) return algorithm_id;
+        }
+        return 0;
+    }
+
+    // Schedule processes as they are read from `input_file` (a pipe, FIFO
+    // or "-" for standard input) and write `process:completion:waiting`
+    // for each one as it completes, processes numbered from 1 in input
+    // order. Only live processes are kept in memory unless
+    // configureStreamSort asked for the input to be sorted first. MLFQ,
+    // CFS, lottery and stride run over the whole trace and are not
+    // available.
+    void runStream(const std::string& input_file, int algorithm_id,
+                   const std::string& output_file) {
+        if (algorithm_id == 7 || algorithm_id == 8 || algorithm_id >= 11) {
+            throw std::runtime_error(std::string(algorithmName(algorithm_id)) +
+                                     " is not available in streaming mode");
+        }
+
+        ResultWriter writer(output_file, echo);
+        OutputBuffer output(&writer);
+        TraceStream input(input_file);
+        input.onWait([&]() { output.flush(); });
+        if (sort_memory == 0) {
+            streamFrom(input, algorithm_id, output);
+            return;
+        }
+
+        input.acceptAnyOrder();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ArrivalSort sorted(input, sort_memory);
+        if (collect_stats) load_ns = elapsedNs(start);
+        streamFrom(sorted, algorithm_id, output);
+    }
+    // Answer what-if queries about one algorithm over the loaded trace, one
+    // per line of `queries`: a process number followed by any of burst,
+    // arrival, priority and deadline, each as field=value or as
+    // field+=change or field-=change relative to the trace. The first line
+    // written is the unchanged run; then each query gets a line with the
+    // new average waiting time and the edited process's completion and
+    // waiting time.
+    void runWhatIf(int algorithm_id, int interval, std::istream& queries,
+                   const std::string& output_file) {
+        if (algorithm_id == 6 && rr_sweep) {
+            throw std::runtime_error("What-if queries do not support --rr-sweep");
+        }
+        if (processes.cycles) {
+            throw std::runtime_error("What-if queries do not support I/O bursts");
+        }
+        WhatIf what_if(processes, algorithm_id, quantum, interval);
+        ResultWriter writer(output_file, echo);
+        OutputBuffer output(&writer);
+        double count = std::max(1, what_if.processCount());
+        double baseline = static_cast<double>(what_if.baselineWaiting() / count);
+        char line[512];
+        int length = std::snprintf(line, sizeof(line),
+            "# %d %s processes=%d waiting_avg=%.6f checkpoints=%d interval=%d\n",
+            algorithm_id, algorithmName(algorithm_id), what_if.processCount(), baseline,
+            what_if.checkpointCount(), what_if.checkpointInterval());
+        output.append(line, static_cast<size_t>(length));
+        output.flush();
+
+        std::string query;
+        int line_number = 0;
+        while (std::getline(queries, query)) {
+            line_number++;
+            size_t start = query.find_first_not_of(" \t\r");
+            if (start == std::string::npos || query[start] == '#') continue;
+            WhatIf::Edit edit = parseQuery(query.c_str() + start, what_if, line_number);
+            WhatIf::Answer answer = what_if.query(edit);
+            length = std::snprintf(line, sizeof(line),
+                "%d burst=%d arrival=%d priority=%d waiting_avg=%.6f baseline=%.6f"
+                " completion=%lld waiting=%lld changed=%d resimulated=%d resumed_at=%lld\n",
+                edit.id + 1, edit.burst_time, edit.arrival_time, edit.priority,
+                static_cast<double>(answer.total_waiting / count), baseline,
+                answer.completion_time, answer.waiting_time, answer.changed,
+                answer.resimulated, answer.resumed_at);
+            output.append(line, static_cast<size_t>(length));
+            output.flush();
+        }
+    }
+
+    // Write the --stats figures of the runs so far as one JSON object
+    void writeStats(std::ostream& out) const {
+        long long output_bytes = 0;
+        out << "{\"load_ns\":" << load_ns << ",\"processes\":" << process_count
+            << ",\"jobs\":" << jobs << ",\"algorithms\":[";
+        bool first = true;
+        for (int algorithm_id = 1; algorithm_id <= ALGORITHM_COUNT; algorithm_id++) {
+            const AlgorithmStats& entry = stats[algorithm_id - 1];
+            if (!entry.ran) continue;
+            output_bytes += entry.bytes;
+            out << (first ? "" : ",") << "{\"id\":" << algorithm_id
+                << ",\"name\":\"" << algorithmName(algorithm_id) << "\""
+                << ",\"simulate_ns\":" << entry.simulate_ns
+                << ",\"report_ns\":" << entry.report_ns
+                << ",\"simulated_time\":" << entry.simulated_time
+                << ",\"events\":" << entry.counters.events
+                << ",\"queue_ops\":" << entry.counters.queue_ops
+                << ",\"dispatches\":" << entry.counters.dispatches
+                << ",\"preemptions\":" << entry.counters.preemptions
+                << ",\"bytes\":" << entry.bytes << "}";
+            first = false;
+        }
+        out << "],\"output_bytes\":" << output_bytes << "}\n";
+    }
+
+    void runAllAlgorithms(const std::string& output_file) {
+        ResultWriter writer(output_file, echo);
+        std::vector<long long> by_id(summary_only ? 0 : process_count);
+
+        // The timeline is written in run order, so it keeps to one thread
+        if (jobs <= 1 || timeline) {
+            OutputBuffer output(&writer);
+            processes.timeline = timeline.get();
+            for (int algorithm_id = 1; algorithm_id <= ALGORITHM_COUNT; algorithm_id++) {
+                if (algorithm_id > 1) processes.reset();
+                if (timeline) timeline->begin(algorithm_id, algorithmName(algorithm_id));
+                execute(algorithm_id, processes);
+                report(algorithm_id, processes, 1, by_id, output);
+            }
+            output.flush();
+            finishTimeline();
+            return;
+        }
+
+        // The algorithms are independent, so each worker runs them on its
+        // own result columns over the shared input columns. Algorithms are
+        // handed out in 1..ALGORITHM_COUNT order and a worker waits for its
+        // turn before writing, so lines come out in the usual order. A
+        // worker that fails sets `failed` so the ones waiting behind it give
+        // up.
+        int workers = std::min(jobs, ALGORITHM_COUNT);
+        std::vector<ProcessTable> tables(workers);
+        std::vector<OutputBuffer> buffers(workers);
+        std::vector<std::vector<long long>> scratch(workers);
+        std::vector<int> runs(workers, 0);
+        std::mutex turn_mutex;
+        std::condition_variable turn_changed;
+        int next_to_write = 1;
+        bool failed = false;
+
+        parallelFor(ALGORITHM_COUNT, jobs, [&](int task, int worker) {
+            try {
+                ProcessTable& table = tables[worker];
+                if (runs[worker]++ == 0) {
+                    table.shareInputs(processes);
+                    scratch[worker].resize(summary_only ? 0 : process_count);
+                } else {
+                    table.reset();
+                }
+                int algorithm_id = task + 1;
+                execute(algorithm_id, table);
+                report(algorithm_id, table, 1, scratch[worker], buffers[worker]);
+
+                std::unique_lock<std::mutex> lock(turn_mutex);
+                turn_changed.wait(lock, [&]() { return failed || next_to_write == algorithm_id; });
+                if (failed) return;
+                buffers[worker].writeTo(writer);
+                next_to_write++;
+                turn_changed.notify_all();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(turn_mutex);
+                failed = true;
+                turn_changed.notify_all();
+                throw;
+            }
+        });
+    }
+
+    // Simulate FCFS, SJF, Priority and Round Robin on `cpus` cores. Each
+    // result line keeps its usual algorithm id and is followed by a `#` line
+    // with per-core utilization and load-balancing figures.
+    void runMulticore(int cpus, long long migration_cost, const std::string& output_file) {
+        static const int algorithm_ids[] = {1, 2, 4, 6};
+        static const MulticoreScheduler::Policy policies[] = {
+            MulticoreScheduler::FCFS, MulticoreScheduler::SJF,
+            MulticoreScheduler::PRIORITY, MulticoreScheduler::ROUND_ROBIN
+        };
+        if (processes.cycles) {
+            throw std::runtime_error("Multi-CPU runs do not support I/O bursts");
+        }
+
+        ResultWriter writer(output_file, echo);
+        OutputBuffer output(&writer);
+        std::vector<long long> by_id(summary_only ? 0 : process_count);
+        MulticoreScheduler multicore(processes, cpus, quantum, migration_cost);
+        processes.timeline = timeline.get();
+
+        for (int i = 0; i < 4; i++) {
+            if (i > 0) processes.reset();
+            if (timeline) timeline->begin(algorithm_ids[i], algorithmName(algorithm_ids[i]));
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            CoreReport cores = multicore.run(policies[i]);
+            if (collect_stats) {
+                // The multi-CPU simulator is timed but not counted
+                AlgorithmStats& entry = stats[algorithm_ids[i] - 1];
+                entry = AlgorithmStats();
+                entry.simulate_ns = elapsedNs(start);
+                entry.simulated_time = cores.makespan;
+                entry.ran = true;
+            }
+            report(algorithm_ids[i], processes, cpus, by_id, output);
+
+            // Utilization per core, then how far the busiest core is above
+            // the mean (0 is perfectly balanced)
+            long long total_busy = 0, max_busy = 0;
+            for (long long busy : cores.busy_time) {
+                total_busy += busy;
+                max_busy = std::max(max_busy, busy);
+            }
+            double mean_busy = static_cast<double>(total_busy) / cpus;
+            char field[96];
+            int length = std::snprintf(field, sizeof(field), "# %d cpus=%d utilization=",
+                                       algorithm_ids[i], cpus);
+            output.append(field, static_cast<size_t>(length));
+            for (int core = 0; core < cpus; core++) {
+                double utilization = cores.makespan > 0
+                    ? static_cast<double>(cores.busy_time[core]) / cores.makespan : 0.0;
+                length = std::snprintf(field, sizeof(field), core > 0 ? ",%.4f" : "%.4f",
+                                       utilization);
+                output.append(field, static_cast<size_t>(length));
+            }
+            length = std::snprintf(field, sizeof(field),
+                                   " imbalance=%.4f steals=%lld migrations=%lld\n",
+                                   mean_busy > 0 ? max_busy / mean_busy - 1 : 0.0,
+                                   cores.steals, cores.migrations);
+            output.append(field, static_cast<size_t>(length));
+        }
+        output.flush();
+        finishTimeline();
+    }
+
+    // Round Robin for every quantum in first..last (inclusive) by step on the
+    // loaded trace, spread over the worker threads. Writes one line per
+    // quantum: quantum:average waiting:average turnaround:context switches.
+    // At most MAX_SWEEP_POINTS quanta are run.
+    void sweepQuantum(int first, int last, int step, const std::string& output_file) {
+        struct SweepResult {
+            long long total_waiting;
+            long long total_turnaround;
+            long long switches;
+        };
+        if (sweepPoints(first, last, step) > MAX_SWEEP_POINTS) {
+            throw std::runtime_error("A quantum sweep runs at most " +
+                                     std::to_string(MAX_SWEEP_POINTS) + " quanta");
+        }
+        int runs = static_cast<int>(sweepPoints(first, last, step));
+        std::vector<SweepResult> results(runs);
+
+        int workers = std::max(1, std::min(jobs, runs));
+        std::vector<ProcessTable> tables(workers);
+        std::vector<int> uses(workers, 0);
+        parallelFor(runs, jobs, [&](int run, int worker) {
+            ProcessTable& table = tables[worker];
+            if (uses[worker]++ == 0) {
+                table.shareInputs(processes);
+            } else {
+                table.reset();
+            }
+
+            SweepResult& result = results[run];
+            NoCounters counters;
+            withArrivals(table, [&](auto& arrivals) {
+                calculateRoundRobin(table, arrivals, first + run * step, counters);
+            });
+            result.switches = table.context_switches;
+            result.total_waiting = 0;
+            result.total_turnaround = 0;
+            for (int row = 0; row < process_count; row++) {
+                result.total_waiting += table.waiting_time[row];
+                result.total_turnaround += table.completion_time[row] - table.arrival_time[row];
+            }
+        });
+
+        ResultWriter writer(output_file, echo);
+        OutputBuffer output(&writer);
+        double count = std::max(1, process_count);
+        for (int run = 0; run < runs; run++) {
+            char line[128];
+            int length = std::snprintf(line, sizeof(line), "%d:%f:%f:%lld\n", first + run * step,
+                                       static_cast<double>(results[run].total_waiting) / count,
+                                       static_cast<double>(results[run].total_turnaround) / count,
+                                       results[run].switches);
+            output.append(line, static_cast<size_t>(length));
+        }
+        output.flush();
+    }
+
+private:
+    // One runWhatIf query line, as the edited inputs of its process
+    static WhatIf::Edit parseQuery(const char* cursor, const WhatIf& what_if, int line_number) {
+        auto fail = [&](const std::string& message) {
+            return std::runtime_error("What-if query on line " + std::to_string(line_number) +
+                                      ": " + message);
+        };
+        char* end;
+        long process = std::strtol(cursor, &end, 10);
+        if (end == cursor || process < 1 || process > what_if.processCount()) {
+            throw fail("expected a process number from 1 to " +
+                       std::to_string(what_if.processCount()));
+        }
+        WhatIf::Edit edit = what_if.original(static_cast<int>(process - 1));
+        cursor = end;
+        while (true) {
+            while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') cursor++;
+            if (*cursor == '\0') break;
+            const char* name = cursor;
+            while (*cursor >= 'a' && *cursor <= 'z') cursor++;
+            std::string field(name, cursor);
+            int* target = field == "burst" ? &edit.burst_time
+                        : field == "arrival" ? &edit.arrival_time
+                        : field == "priority" ? &edit.priority
+                        : field == "deadline" ? &edit.deadline : nullptr;
+            if (!target) throw fail("expected burst, arrival, priority or deadline");
+            if (target == &edit.deadline && *cursor != '=' &&
+                edit.deadline == ProcessTable::NO_DEADLINE) {
+                throw fail("process has no deadline to change");
+            }
+            int sign = 0;
+            if (*cursor == '+' || *cursor == '-') sign = *cursor++ == '+' ? 1 : -1;
+            if (*cursor != '=') throw fail("expected = after " + field);
+            cursor++;
+            long long value = std::strtoll(cursor, &end, 10);
+            if (end == cursor) throw fail("expected a number after " + field);
+            cursor = end;
+            if (sign != 0) value = *target + sign * value;
+            if (value < INT_MIN || value > INT_MAX) throw fail(field + " out of range");
+            *target = static_cast<int>(value);
+        }
+        if (edit.burst_time < 0) throw fail("burst time must not be negative");
+        if (edit.deadline < 0 && edit.deadline != ProcessTable::NO_DEADLINE) {
+            throw fail("deadline must not be negative");
+        }
+        return edit;
+    }
+
+    // Run one algorithm, timed and counted when stats are on. Each
+    // algorithm id only ever runs on one thread at a time.
+    void execute(int algorithm_id, ProcessTable& table) {
+        if (!collect_stats) {
+            NoCounters counters;
+            runAlgorithm(algorithm_id, table, counters);
+            return;
+        }
+        AlgorithmStats& entry = stats[algorithm_id - 1];
+        entry = AlgorithmStats();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        runAlgorithm(algorithm_id, table, entry.counters);
+        entry.simulate_ns = elapsedNs(start);
+        for (int row = 0; row < table.size(); row++) {
+            entry.simulated_time = std::max(entry.simulated_time, table.completion_time[row]);
+        }
+        entry.ran = true;
+    }
+
+    // The body of runStream over `input`, a TraceStream or an ArrivalSort
+    template <typename Source>
+    void streamFrom(Source& input, int algorithm_id, OutputBuffer& output) {
+        StreamPool pool;
+        pool.timeline = timeline.get();
+        if (timeline) timeline->begin(algorithm_id, algorithmName(algorithm_id));
+        StreamArrivals<Source> arrivals(input, pool);
+        RunMetrics run;
+        auto finish = [&](int row, long long current_time) {
+            long long waiting_time = current_time - pool.arrival_time[row] - pool.burst_time[row];
+            if (!summary_only) {
+                output.append(static_cast<long long>(pool.id[row]) + 1);
+                output.append(':');
+                output.append(current_time);
+                output.append(':');
+                output.append(waiting_time);
+                output.append('\n');
+            }
+            run.add(pool.arrival_time[row], pool.burst_time[row], pool.first_run[row],
+                    current_time, pool.deadline[row], 0);
+            pool.release(row);
+        };
+
+        if (collect_stats) {
+            // Reading (unless the input was sorted first, which is in
+            // load_ns) and formatting overlap the simulation here, so they
+            // are in simulate_ns
+            AlgorithmStats& entry = stats[algorithm_id - 1];
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            runStreamed(algorithm_id, pool, arrivals, finish, entry.counters);
+            entry.simulate_ns = elapsedNs(start);
+            entry.simulated_time = run.last_completion;
+            entry.bytes = static_cast<long long>(output.total());
+            entry.ran = true;
+        } else {
+            NoCounters counters;
+            runStreamed(algorithm_id, pool, arrivals, finish, counters);
+        }
+
+        process_count = run.processes;
+        run.context_switches = pool.context_switches;
+        if (metrics || summary_only) writeSummary(algorithm_id, run, 1, output);
+        output.flush();
+        if (timeline) timeline->finish();
+    }
+
+    template <typename Arrivals, typename Finish, typename Counters>
+    void runStreamed(int algorithm_id, StreamPool& pool, Arrivals& arrivals,
+                     Finish& finish, Counters& counters) const {
+        switch (algorithm_id) {
+            case 1:
+                Engine<ArrivalOrder<StreamPool>, Preemption::NONE, FifoQueue>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+            case 2:
+                Engine<ShortestRemaining<StreamPool>, Preemption::NONE>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+            case 3:
+                Engine<ShortestRemaining<StreamPool>, Preemption::ON_ARRIVAL>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+            case 4:
+                Engine<HighestPriority<StreamPool>, Preemption::NONE>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+            case 5:
+                Engine<HighestPriority<StreamPool>, Preemption::ON_ARRIVAL>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+            case 6:
+                Engine<ArrivalOrder<StreamPool>, Preemption::TIME_SLICE, FifoQueue>::run(
+                    pool, arrivals, quantum, finish, counters);
+                break;
+            case 9:
+                Engine<EarliestDeadline<StreamPool>, Preemption::NONE>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+            case 10:
+                Engine<EarliestDeadline<StreamPool>, Preemption::ON_ARRIVAL>::run(
+                    pool, arrivals, INT_MAX, finish, counters);
+                break;
+        }
+    }
+
+    void finishTimeline() {
+        processes.timeline = nullptr;
+        if (timeline) timeline->finish();
+    }
+
+    // Write what the report settings ask for about one finished run on
+    // `cpus` CPUs. `by_id` is only used for the result line.
+    void report(int algorithm_id, const ProcessTable& table, int cpus,
+                std::vector<long long>& by_id, OutputBuffer& output) {
+        std::chrono::steady_clock::time_point start;
+        size_t bytes_before = output.total();
+        if (collect_stats) start = std::chrono::steady_clock::now();
+
+        long double& total_waiting = waiting_totals[algorithm_id - 1];
+        if (!summary_only) total_waiting = writeResults(algorithm_id, table, by_id, output);
+        if (metrics || summary_only) {
+            RunMetrics run(table);
+            // Shares assume a process is runnable from arrival to completion
+            if ((algorithm_id == 11 || algorithm_id == 12) && !table.cycles) {
+                run.shares = ShareAccuracy(table);
+            }
+            total_waiting = run.total_waiting;
+            writeSummary(algorithm_id, run, cpus, output);
+        }
+
+        if (collect_stats) {
+            AlgorithmStats& entry = stats[algorithm_id - 1];
+            entry.report_ns += elapsedNs(start);
+            entry.bytes += static_cast<long long>(output.total() - bytes_before);
+        }
+    }
+
+    // Format one result line: the algorithm id, every waiting time in
+    // original id order and the average. Rows are scattered into `by_id` by
+    // their id, which is O(n).
+    // Returns the total waiting time.
+    long double writeResults(int algorithm_id, const ProcessTable& table,
+                             std::vector<long long>& by_id, OutputBuffer& output) const {
+        long double total_waiting_time = 0;
+        for (int row = 0; row < process_count; row++) {
+            by_id[table.id[row]] = table.waiting_time[row];
+            total_waiting_time += table.waiting_time[row];
+        }
+
+        output.append(static_cast<long long>(algorithm_id));
+        for (int i = 0; i < process_count; i++) {
+            output.append(':');
+            output.append(by_id[i]);
+        }
+
+        double avg_waiting_time = process_count > 0
+            ? static_cast<double>(total_waiting_time / process_count) : 0.0;
+        char average[64];
+        int length = std::snprintf(average, sizeof(average), ":%f\n", avg_waiting_time);
+        output.append(average, static_cast<size_t>(length));
+        return total_waiting_time;
+    }
+
+    // Format one summary line: `# id name`, then key=value pairs for the
+    // throughput (completions per time unit), CPU utilization, context
+    // switches and the average and percentiles of waiting, turnaround and
+    // response time. When the trace has deadlines the line ends with the
+    // misses and the total and maximum lateness; lottery and stride add
+    // their ShareAccuracy. A trace with I/O bursts adds each device's
+    // utilization and the fraction of the makespan in which the CPU and at
+    // least one device were busy at once.
+    void writeSummary(int algorithm_id, const RunMetrics& run, int cpus,
+                      OutputBuffer& output) const {
+        double count = std::max(1, run.processes);
+        double span = static_cast<double>(run.makespan());
+        char line[768];
+        int length = std::snprintf(line, sizeof(line),
+            "# %d %s processes=%d makespan=%lld throughput=%.6f utilization=%.4f"
+            " context_switches=%lld response_avg=%.6f"
+            " waiting_avg=%.6f waiting_p50=%lld waiting_p90=%lld waiting_p99=%lld"
+            " waiting_p99.9=%lld turnaround_avg=%.6f turnaround_p50=%lld"
+            " turnaround_p90=%lld turnaround_p99=%lld turnaround_p99.9=%lld",
+            algorithm_id, algorithmName(algorithm_id), run.processes, run.makespan(),
+            span > 0 ? run.processes / span : 0.0,
+            span > 0 ? run.busy_time / (span * cpus) : 0.0,
+            run.context_switches,
+            static_cast<double>(run.total_response / count),
+            static_cast<double>(run.total_waiting / count),
+            run.waiting.quantile(0.5), run.waiting.quantile(0.9),
+            run.waiting.quantile(0.99), run.waiting.quantile(0.999),
+            static_cast<double>(run.total_turnaround / count),
+            run.turnaround.quantile(0.5), run.turnaround.quantile(0.9),
+            run.turnaround.quantile(0.99), run.turnaround.quantile(0.999));
+        output.append(line, static_cast<size_t>(length));
+        if (run.deadlines > 0) {
+            length = std::snprintf(line, sizeof(line),
+                " deadlines=%d deadline_misses=%d lateness_total=%.0Lf lateness_max=%lld",
+                run.deadlines, run.deadline_misses, run.total_lateness, run.max_lateness);
+            output.append(line, static_cast<size_t>(length));
+        }
+        if (run.shares.measured) {
+            length = std::snprintf(line, sizeof(line), " share_error=%.6f share_lag_max=%.3f",
+                                   run.shares.error, run.shares.max_lag);
+            output.append(line, static_cast<size_t>(length));
+        }
+        if (!run.device_busy.empty()) {
+            for (size_t device = 0; device < run.device_busy.size(); device++) {
+                length = std::snprintf(line, sizeof(line),
+                                       device > 0 ? ",%.4f" : " device_utilization=%.4f",
+                                       span > 0 ? run.device_busy[device] / span : 0.0);
+                output.append(line, static_cast<size_t>(length));
+            }
+            long long overlap = run.busy_time + run.io_busy - run.in_system;
+            length = std::snprintf(line, sizeof(line), " io_overlap=%.4f",
+                                   span > 0 ? overlap / span : 0.0);
+            output.append(line, static_cast<size_t>(length));
+        }
+        output.append('\n');
+    }
+};
+
+#endif  // CPE351_H